@@ -0,0 +1,117 @@
+// =============================================================================
+// fastComplexFFT against stdComplexFFT
+// =============================================================================
+//
+// Times one forward transform of 2^8 ... 2^16 points, bit-reversed load
+// included, with the plan-based radix-2 loop of stdComplexFFT and with
+// every radix-2^2 butterfly kernel the CPU supports. The buffers stay in
+// cache, so the table compares the arithmetic of the kernels, not memory.
+//
+// Usage: fft_bench [repeats]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "fftkernel.hpp"
+
+struct BenchKernel {
+    const char * name;
+    fftKernelFunc_t func;
+    CpuLevel level;
+};
+
+/**
+ * @brief Лучшее из repeats среднее время calls вызовов, секунд
+ */
+template<class Func_T>
+static double benchBest(size_t repeats, size_t calls, Func_T run)
+{
+    double best = 0;
+    for (size_t r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < calls; c++) {
+            run();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double seconds = elapsed.count() / calls;
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t repeats = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20;
+    if (repeats == 0) {
+        std::fprintf(stderr, "Usage: %s [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    const BenchKernel kernels[] = {
+        {"scalar", fftRadix4Scalar, CpuLevel_Scalar},
+#ifdef IQCONVERT_X86
+        {"sse4.1", fftRadix4SSE41, CpuLevel_SSE41},
+        {"avx2", fftRadix4AVX2, CpuLevel_AVX2},
+        {"avx512", fftRadix4AVX512, CpuLevel_AVX512},
+#endif
+    };
+
+    std::printf("us per transform, best of %zu, CPU level %s, fastComplexFFT dispatched to %s\n", \
+                repeats, cpuLevelName(cpuLevelDetect()), cpuLevelName(fftKernel().level));
+    std::printf("%-6s %10s", "order", "radix2");
+    for (const BenchKernel & kernel : kernels) {
+        std::printf(" %10s", kernel.name);
+    }
+    std::printf(" %10s\n", "dispatched");
+
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    for (int order = 8; order <= 16; order++) {
+        const fftPlan_t & plan = fftPlan_t::get(order);
+        const uint32_t n = plan.size();
+        const uint32_t * reverse = plan.reverse();
+        std::vector<std::complex<float>> x(n);
+        std::vector<std::complex<float>> y(n);
+        for (std::complex<float> & item : x) {
+            item = std::complex<float>(noise(generator), noise(generator));
+        }
+        // About 2^20 points per timing, so small orders are not lost in the clock
+        const size_t calls = std::max<size_t>(1, ((size_t)1 << 20) / n);
+
+        const double radix2 = benchBest(repeats, calls, [&]() {
+            stdComplexFFT(x.data(), y.data(), plan);
+        });
+        std::printf("2^%-4d %10.2f", order, radix2 * 1e6);
+
+        // Levels are timed through the kernels themselves, with the same
+        // load as fastComplexFFT: cpuLevel() is fixed for the process
+        for (const BenchKernel & kernel : kernels) {
+            if (kernel.level > cpuLevelDetect()) {
+                std::printf(" %10s", "-");
+                continue;
+            }
+            const double seconds = benchBest(repeats, calls, [&]() {
+                for (uint32_t i = 0; i < n; ++i) {
+                    y[reverse[i]] = x[i];
+                }
+                kernel.func(y.data(), plan);
+            });
+            std::printf(" %10.2f", seconds * 1e6);
+        }
+
+        const double seconds = benchBest(repeats, calls, [&]() {
+            fastComplexFFT(x.data(), y.data(), plan);
+        });
+        std::printf(" %10.2f\n", seconds * 1e6);
+    }
+
+    return 0;
+}
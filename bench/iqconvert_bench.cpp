@@ -0,0 +1,112 @@
+// =============================================================================
+// iqConvert throughput against memcpy
+// =============================================================================
+//
+// Converts one large iq16_t buffer with every iqConvert kernel the CPU
+// supports and copies the same number of output bytes with memcpy. The
+// conversion reads 4 and writes 8 bytes per sample, so on buffers well
+// above the last level cache every kernel is bound by memory bandwidth and
+// the ratio to memcpy shows what is left of the arithmetic. Run-to-run
+// noise on a loaded machine can exceed the gap between the vector levels.
+//
+// Usage: iqconvert_bench [samples] [repeats]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "iqconvert.hpp"
+
+struct BenchKernel {
+    const char * name;
+    iqConvertFunc_t func;
+    CpuLevel level;
+};
+
+/**
+ * @brief Лучшее время из repeats запусков, секунд
+ */
+template<class Func_T>
+static double benchBest(size_t repeats, Func_T run)
+{
+    double best = 0;
+    for (size_t r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+static void benchReport(const char * name, double seconds, size_t samples, double reference)
+{
+    const double bytes = (double)samples * sizeof (std::complex<float>);
+    std::printf("%-12s %10.3f ms %8.2f GB/s written %8.3f ns/sample", name, seconds * 1e3, \
+                bytes / seconds / 1e9, seconds * 1e9 / samples);
+    if (reference > 0) {
+        std::printf(" %6.2fx memcpy", seconds / reference);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (size_t)1 << 25;
+    const size_t repeats = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10;
+    if (samples == 0 || repeats == 0) {
+        std::fprintf(stderr, "Usage: %s [samples] [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<iq16_t> src(samples);
+    for (size_t i = 0; i < samples; i++) {
+        src[i].I = (int16_t)(i * 7919);
+        src[i].Q = (int16_t)(i * 104729);
+    }
+    // Destinations are written once up front, so page faults stay out of the timings
+    std::vector<std::complex<float>> dst(samples);
+    std::vector<std::complex<float>> copy(samples);
+
+    std::printf("%zu samples, best of %zu, CPU level %s\n", samples, repeats, \
+                cpuLevelName(cpuLevelDetect()));
+
+    const double reference = benchBest(repeats, [&]() {
+        std::memcpy(copy.data(), dst.data(), samples * sizeof (std::complex<float>));
+    });
+    benchReport("memcpy", reference, samples, 0);
+
+    const BenchKernel kernels[] = {
+        {"scalar", iqConvertScalar, CpuLevel_Scalar},
+#ifdef IQCONVERT_X86
+        {"sse2", iqConvertSSE2, CpuLevel_SSE2},
+        {"avx2", iqConvertAVX2, CpuLevel_AVX2},
+        {"avx512", iqConvertAVX512, CpuLevel_AVX512},
+#endif
+    };
+
+    // Levels are timed through the kernels themselves: cpuLevel() is fixed
+    // for the process, and the dispatched entry point is timed separately
+    for (const BenchKernel & kernel : kernels) {
+        if (kernel.level > cpuLevelDetect()) {
+            std::printf("%-12s not supported\n", kernel.name);
+            continue;
+        }
+        const double seconds = benchBest(repeats, [&]() {
+            kernel.func(src.data(), dst.data(), samples, 1.0f, {0, 0}, nullptr);
+        });
+        benchReport(kernel.name, seconds, samples, reference);
+    }
+
+    const double seconds = benchBest(repeats, [&]() {
+        iqConvert(src.data(), dst.data(), samples);
+    });
+    std::printf("dispatched to %s:\n", cpuLevelName(iqConvertKernel().level));
+    benchReport("iqConvert", seconds, samples, reference);
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Блочное чтение файла записи крупными выровненными запросами
+ *
+ * Используется потоком ChunkStreamer вместо отображения файла в память.
+ * В режиме прямого ввода-вывода (O_DIRECT) смещение, длина и адрес буфера
+ * выравниваются по alignment, данные идут с диска в буфер, минуя
+ * страничный кэш. При отсутствии поддержки O_DIRECT (tmpfs, не-POSIX
+ * системы) используется обычное буферизованное чтение.
+ */
+class BlockReader {
+protected:
+#ifdef __unix__
+    int fd{-1};
+#else
+    QFile file;
+#endif
+    bool direct{false};
+
+public:
+    static constexpr size_t alignment = 4096;
+
+    BlockReader() {}
+    BlockReader(const BlockReader &) = delete;
+    BlockReader & operator=(const BlockReader &) = delete;
+
+    ~BlockReader() {
+        this->close();
+    }
+
+    /**
+     * @brief Открытие файла записи на чтение
+     * @param path Путь к файлу
+     * @param directIO Запрос прямого ввода-вывода
+     * @return true при успешном открытии
+     */
+    bool open(const QString & path, bool directIO) {
+        this->close();
+        this->direct = false;
+
+#ifdef __unix__
+        const QByteArray name = QFile::encodeName(path);
+#ifdef O_DIRECT
+        if (directIO) {
+            this->fd = ::open(name.constData(), O_RDONLY | O_DIRECT);
+            if (this->fd >= 0) {
+                this->direct = true;
+                return true;
+            }
+            std::cerr << "O_DIRECT is not supported for " << name.constData() \
+                      << ", falling back to buffered reads" << std::endl << std::flush;
+        }
+#endif
+        this->fd = ::open(name.constData(), O_RDONLY);
+        if (this->fd < 0) {
+            return false;
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return true;
+#else
+        (void)directIO;
+        this->file.setFileName(path);
+        return this->file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+#endif
+    }
+
+    void close(void) {
+#ifdef __unix__
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+#else
+        if (this->file.isOpen()) {
+            this->file.close();
+        }
+#endif
+    }
+
+    bool isDirect(void) const {
+        return this->direct;
+    }
+
+    /**
+     * @brief Размер буфера, достаточный для чтения bytes байт с любого смещения
+     */
+    static size_t bufferSize(size_t bytes) {
+        return bytes + 2 * BlockReader::alignment;
+    }
+
+    /**
+     * @brief Чтение участка файла в буфер
+     * @param offset Смещение участка в файле, байт
+     * @param bytes Длина участка, байт
+     * @param dst Буфер, выровненный по alignment
+     * @param capacity Размер буфера (не менее bufferSize(bytes))
+     * @return Указатель на первый байт участка внутри dst либо nullptr
+     */
+    const uchar * read(uint64_t offset, size_t bytes, uchar * dst, size_t capacity) {
+        uint64_t start = offset;
+        size_t length = bytes;
+        if (this->direct) {
+            start = offset & ~(uint64_t)(BlockReader::alignment - 1);
+            length = (offset - start + bytes + BlockReader::alignment - 1) & ~(BlockReader::alignment - 1);
+        }
+        if (length > capacity) {
+            return nullptr;
+        }
+
+        const size_t needed = offset - start + bytes;
+        size_t done = 0;
+#ifdef __unix__
+        while (done < needed) {
+            ssize_t ret = ::pread(this->fd, dst + done, length - done, start + done);
+            if (ret <= 0) {
+                break;
+            }
+            done += ret;
+        }
+#else
+        if (this->file.seek(start)) {
+            qint64 ret = this->file.read(reinterpret_cast<char *>(dst), length);
+            done = ret > 0 ? ret : 0;
+        }
+#endif
+        if (done < needed) {
+            return nullptr;
+        }
+        return dst + (offset - start);
+    }
+};
+
+#endif // BLOCKREADER_H
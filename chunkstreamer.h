@@ -0,0 +1,311 @@
+#ifndef CHUNKSTREAMER_H
+#define CHUNKSTREAMER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+#include <QtGlobal>
+
+#include "samplesource.h"
+#include "blockreader.h"
+#include "taskqueue.h"
+#include "colormapworker.h"
+
+/**
+ * @brief Поставщик блоков записи для рабочих потоков ColorMapWorker
+ *
+ * Проходит запись (либо её участок, начиная с firstSample) блоками
+ * (chunk) по rowsPerChunk строк водопада и
+ * отдаёт их в очередь задач по мере готовности. Соседние блоки
+ * перекрываются на span - step отсчётов (span - отсчёты одной строки,
+ * больше windowSize для усреднённых строк), поэтому строки на
+ * границах блоков не теряются. Одновременно в работе находится не
+ * более chunksInFlight блоков: пиковый объём памяти определяется
+ * бюджетом и не зависит от размера файла.
+ *
+ * В режимах чтения (ChunkStreamer_Mode_Read, _DirectRead) блоки не
+ * отображаются, а читаются BlockReader в кольцо заранее выделенных
+ * выровненных буферов: пока рабочие потоки считают FFT по одним блокам,
+ * поток поставщика заполняет следующие, и время диска и процессора
+ * перекрывается.
+ *
+ * В режиме ChunkStreamer_Mode_Container источник - сжатый контейнер
+ * .wfiq: поток поставщика читает только сжатые блоки, покрывающие
+ * участок, а распаковка в буфер отсчётов выполняется рабочим потоком,
+ * взявшим задачу, непосредственно перед расчётом FFT.
+ */
+class ChunkStreamer {
+public:
+    enum ChunkStreamer_Mode_ : uint16_t {
+        ChunkStreamer_Mode_Mapped = 0,
+        ChunkStreamer_Mode_Read,
+        ChunkStreamer_Mode_DirectRead,
+        ChunkStreamer_Mode_Container
+    };
+
+protected:
+    SampleSource * source{nullptr};
+    TaskQueue<std::shared_ptr<ColorMapWorkerTask>> * tasks{nullptr};
+
+    std::thread streamerThread;
+    std::atomic_bool stopped{true};
+
+    std::mutex budgetMutex;
+    std::condition_variable budgetCond;
+    size_t chunksInFlight{1};
+    std::vector<size_t> freeSlots;
+
+    uint16_t mode{ChunkStreamer_Mode_Mapped};
+    BlockReader reader;
+    std::vector<uchar *> buffers;
+    std::vector<uchar *> decoded;
+    size_t bufferBytes{0};
+    size_t decodedBytes{0};
+
+    QCPColorMap * targetMap{nullptr};
+    uint64_t firstSample{0};
+    size_t firstRow{0};
+    size_t rows{0};
+    size_t rowsPerChunk{1};
+    size_t windowSize{0};
+    size_t span{0};
+    size_t step{0};
+
+    bool acquireChunk(size_t & slot) {
+        std::unique_lock<std::mutex> lock(this->budgetMutex);
+        this->budgetCond.wait(lock, [this]() {
+            return !this->freeSlots.empty() || this->stopped.load();
+        });
+        if (this->stopped.load()) {
+            return false;
+        }
+        slot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+        return true;
+    }
+
+    void releaseChunk(size_t slot, const uchar * region) {
+        if (this->mode == ChunkStreamer_Mode_Mapped) {
+            this->source->unmapRegion(region);
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->budgetMutex);
+            this->freeSlots.push_back(slot);
+        }
+        this->budgetCond.notify_one();
+    }
+
+    void freeBuffers(void) {
+        for (uchar * buffer : this->buffers) {
+            qFreeAligned(buffer);
+        }
+        for (uchar * buffer : this->decoded) {
+            qFreeAligned(buffer);
+        }
+        this->buffers.clear();
+        this->decoded.clear();
+        this->bufferBytes = 0;
+        this->decodedBytes = 0;
+    }
+
+    void allocBuffers(std::vector<uchar *> & ring, size_t & ringBytes, size_t required) {
+        if (ringBytes != required || ring.size() != this->chunksInFlight) {
+            for (uchar * buffer : ring) {
+                qFreeAligned(buffer);
+            }
+            ring.clear();
+            for (size_t i = 0; i < this->chunksInFlight; i++) {
+                ring.push_back(static_cast<uchar *>(qMallocAligned(required, BlockReader::alignment)));
+            }
+            ringBytes = required;
+        }
+    }
+
+    const uchar * fetchChunk(size_t slot, uint64_t first, uint64_t count) {
+        if (this->mode == ChunkStreamer_Mode_Mapped) {
+            return this->source->mapRegion(first, count);
+        }
+        if (this->mode == ChunkStreamer_Mode_Container) {
+            const IQContainer & container = this->source->container();
+            const uint64_t firstBlock = first / container.blockSamples();
+            const uint64_t lastBlock = (first + count - 1) / container.blockSamples() + 1;
+            const uint64_t offset = container.blockOffset(firstBlock);
+            return this->reader.read(offset, container.blockOffset(lastBlock) - offset, \
+                                     this->buffers[slot], this->bufferBytes);
+        }
+        const size_t sampleSize = sampleFormatSize(this->source->format());
+        return this->reader.read(first * sampleSize, count * sampleSize, \
+                                 this->buffers[slot], this->bufferBytes);
+    }
+
+    /**
+     * @brief Распаковка блоков контейнера, прочитанных fetchChunk()
+     * @return Указатель на отсчёт first в буфере отсчётов слота
+     */
+    const uchar * decodeChunk(size_t slot, const uchar * compressed, uint64_t first, uint64_t count) {
+        const IQContainer & container = this->source->container();
+        const uint64_t firstBlock = first / container.blockSamples();
+        const uint64_t lastBlock = (first + count - 1) / container.blockSamples() + 1;
+
+        iq16_t * samples = reinterpret_cast<iq16_t *>(this->decoded[slot]);
+        if (!container.decode(compressed, firstBlock, lastBlock, samples)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const uchar *>(samples + (first - firstBlock * container.blockSamples()));
+    }
+
+    void process(void) {
+        for (size_t row = 0; row < this->rows; row += this->rowsPerChunk) {
+            size_t slot = 0;
+            if (!this->acquireChunk(slot)) {
+                break;
+            }
+
+            size_t chunkRows = std::min(this->rowsPerChunk, this->rows - row);
+            uint64_t first = this->firstSample + (uint64_t)row * this->step;
+            uint64_t count = (uint64_t)(chunkRows - 1) * this->step + this->span;
+
+            const uchar * region = this->fetchChunk(slot, first, count);
+            if (region == nullptr) {
+                std::cerr << "Error on fetching record region at sample " << first << std::endl << std::flush;
+                this->releaseChunk(slot, nullptr);
+                break;
+            }
+
+            std::function<const uchar * (void)> prepare;
+            if (this->mode == ChunkStreamer_Mode_Container) {
+                prepare = [this, slot, region, first, count]() {
+                    return this->decodeChunk(slot, region, first, count);
+                };
+            }
+
+            // The region is released as soon as the last worker drops the task
+            std::shared_ptr<ColorMapWorkerTask> task(new ColorMapWorkerTask(region, this->source->format(), \
+                                                                            this->targetMap, \
+                                                                            this->firstRow + row, chunkRows, \
+                                                                            this->windowSize, this->step, \
+                                                                            std::move(prepare)), \
+                                                     [this, slot, region](ColorMapWorkerTask * item) {
+                delete item;
+                this->releaseChunk(slot, region);
+            });
+            this->tasks->push(std::move(task));
+        }
+        this->tasks->close();
+    }
+
+public:
+    ChunkStreamer(SampleSource * pSource, TaskQueue<std::shared_ptr<ColorMapWorkerTask>> * pTasks) : \
+        source(pSource), tasks(pTasks) {}
+
+    ~ChunkStreamer() {
+        this->abortStreaming();
+        this->freeBuffers();
+    }
+
+    /**
+     * @brief Запуск прохода по записи
+     * @param map Целевая карта водопада
+     * @param first Отсчёт записи, соответствующий началу строки 0
+     * @param rowsCount Общее количество строк
+     * @param wSize Размер окна FFT
+     * @param rowStep Шаг между строками в отсчётах
+     * @param memoryBudget Бюджет памяти под блоки в работе, байт
+     * @param chunks Количество одновременно находящихся в работе блоков
+     * @param ioMode Способ получения блоков (ChunkStreamer_Mode_)
+     * @param mapRow Строка карты, соответствующая строке 0 прохода
+     * @param rowSpan Отсчёты одной строки, 0 - wSize (строки без усреднения)
+     * @return false, если файл не удалось открыть на чтение либо режим
+     * не соответствует источнику (сжатый контейнер читается только в
+     * режиме ChunkStreamer_Mode_Container)
+     */
+    bool startStreaming(QCPColorMap * map, uint64_t first, size_t rowsCount, size_t wSize, \
+                        size_t rowStep, uint64_t memoryBudget, size_t chunks, \
+                        uint16_t ioMode = ChunkStreamer_Mode_Mapped, size_t mapRow = 0, \
+                        size_t rowSpan = 0) {
+        this->abortStreaming();
+
+        this->targetMap = map;
+        this->firstSample = first;
+        this->firstRow = mapRow;
+        this->rows = rowsCount;
+        this->windowSize = wSize;
+        this->span = std::max(wSize, rowSpan);
+        this->step = rowStep;
+        this->chunksInFlight = std::max<size_t>(1, chunks);
+        this->mode = ioMode;
+
+        if (this->source->isCompressed() != (this->mode == ChunkStreamer_Mode_Container)) {
+            return false;
+        }
+
+        this->freeSlots.resize(this->chunksInFlight);
+        for (size_t i = 0; i < this->chunksInFlight; i++) {
+            this->freeSlots[i] = i;
+        }
+
+        const size_t sampleSize = sampleFormatSize(this->source->format());
+        uint64_t chunkSamples = memoryBudget / this->chunksInFlight / sampleSize;
+        if (this->mode == ChunkStreamer_Mode_Container) {
+            // Every slot holds both the compressed and the unpacked chunk
+            chunkSamples /= 2;
+        }
+        if (chunkSamples < this->span) {
+            chunkSamples = this->span;
+        }
+        this->rowsPerChunk = (chunkSamples - this->span) / rowStep + 1;
+
+        if (this->mode != ChunkStreamer_Mode_Mapped) {
+            if (!this->reader.open(this->source->fileName(), this->mode == ChunkStreamer_Mode_DirectRead)) {
+                return false;
+            }
+
+            // Ring of aligned blocks, reused for every pass with the same geometry
+            const uint64_t chunkCount = (uint64_t)(this->rowsPerChunk - 1) * rowStep + this->span;
+            if (this->mode == ChunkStreamer_Mode_Container) {
+                const IQContainer & container = this->source->container();
+                const uint64_t spanBlocks = chunkCount / container.blockSamples() + 2;
+                this->allocBuffers(this->buffers, this->bufferBytes, \
+                                   BlockReader::bufferSize(container.compressedBound(chunkCount)));
+                this->allocBuffers(this->decoded, this->decodedBytes, \
+                                   spanBlocks * container.blockSamples() * sizeof (iq16_t));
+            } else {
+                this->allocBuffers(this->buffers, this->bufferBytes, \
+                                   BlockReader::bufferSize(chunkCount * sampleSize));
+            }
+        } else {
+            this->freeBuffers();
+        }
+
+        this->stopped.store(false);
+        try {
+            this->streamerThread = std::thread(std::bind(&ChunkStreamer::process, this));
+        } catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl << std::flush;
+            return false;
+        }
+        return true;
+    }
+
+    bool isDirect(void) const {
+        return this->mode != ChunkStreamer_Mode_Mapped && this->reader.isDirect();
+    }
+
+    void abortStreaming(void) {
+        {
+            std::lock_guard<std::mutex> lock(this->budgetMutex);
+            this->stopped.store(true);
+        }
+        this->budgetCond.notify_all();
+        if (this->streamerThread.joinable())
+            this->streamerThread.join();
+    }
+};
+
+#endif // CHUNKSTREAMER_H
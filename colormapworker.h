@@ -13,75 +13,156 @@
 #include <algorithm>
 #include <atomic>
 #include <mutex>
+#include <memory>
+#include <type_traits>
+#include <limits>
 #include <iostream>
 
 #include "dsp.hpp"
-
+#include "sampleformat.hpp"
+#include "fftkernel.hpp"
+#include "fftmixed.hpp"
+#include "fftfixed.hpp"
+#include "fftbackend.hpp"
+#include "spectrum.hpp"
+#include "window.hpp"
+#include "pfb.hpp"
+#include "taskqueue.h"
+
+/**
+ * @brief Блок строк водопада, обрабатываемый одним рабочим потоком
+ *
+ * signal указывает на первый отсчёт блока в формате format; строка r
+ * блока начинается с отсчёта r * step и соответствует строке
+ * mapIndex + r карты. Если задан prepare, отсчёты блока готовит
+ * (например, распаковывает) взявший задачу рабочий поток, и signal
+ * заменяется его результатом.
+ */
 class ColorMapWorkerTask {
 protected:
-    std::vector<std::complex<float>> * signal;
+    const uchar * signal;
+    SampleFormat format;
     QCPColorMap * targetMap;
 
     size_t mapIndex;
+    size_t rowsCount;
     size_t windowSize;
     size_t step;
 
-    std::atomic_bool inWork{false};
-    std::mutex taskMutex;
+    std::function<const uchar * (void)> prepare;
 
 public:
-    typedef std::vector<std::complex<float>> cplxSignal_t;
-
     ColorMapWorkerTask() {}
-    ColorMapWorkerTask(cplxSignal_t * pSignal, \
+    ColorMapWorkerTask(const uchar * pSignal, SampleFormat format, \
                        QCPColorMap * targetMap, \
-                       size_t index, size_t wSize, \
-                       size_t step) : \
-        signal(pSignal), targetMap(targetMap), \
-        mapIndex(index), windowSize(wSize), step(step) {}
-
-    bool takeWork(void) {
-        std::lock_guard<std::mutex> lock(this->taskMutex);
-        if (this->inWork.load() != true) {
-            this->inWork.store(true);
-            return true;
-        }
-        return false;
-    }
+                       size_t index, size_t rows, \
+                       size_t wSize, size_t step, \
+                       std::function<const uchar * (void)> prepare = nullptr) : \
+        signal(pSignal), format(format), targetMap(targetMap), \
+        mapIndex(index), rowsCount(rows), \
+        windowSize(wSize), step(step), prepare(std::move(prepare)) {}
 
     friend class ColorMapWorker;
 };
 
+/**
+ * @brief Параметры обработки, общие для всех задач прохода
+ */
+struct ColorMapWorkerParams {
+    bool dcRemoval{false};
+    std::complex<float> dcOffset{0, 0};
+    // Ready plan of an external FFT backend, nullptr - built-in kernels
+    const FFTBackendPlan * backend{nullptr};
+    // Quick look: int16 records through the Q15 block floating point FFT
+    bool fixedPoint{false};
+    // Cell values of the map: magnitude, power or power in dB
+    SpectrumScale scale{SpectrumScale_Magnitude};
+    // Shared window tables of the pass size, nullptr - rectangular. Tables
+    // of several taps turn the rows into a polyphase filter bank
+    const FFTWindow * window{nullptr};
+    // Time decimation: a row reduces the power of this many transforms,
+    // task.step / average samples apart, by their mean (Welch) or a hold
+    size_t average{1};
+    SpectrumReduce reduce{SpectrumReduce_Mean};
+};
+
 class ColorMapWorker : public QObject
 {
     Q_OBJECT
 
-    std::vector<ColorMapWorkerTask *> * tasks;
+    TaskQueue<std::shared_ptr<ColorMapWorkerTask>> * tasks;
     float maxValue{0};
 
     std::thread executorThread;
     std::atomic_bool stopped{true};
     std::atomic_bool running{false};
 
-    std::vector<std::complex<float>> complexFFTRes;
+    ColorMapWorkerParams params;
+
+    // Row buffers are cache-line aligned: FFTW plans run on them in place of a copy
+    AlignedVector<std::complex<float>> complexFFTIn;
+    AlignedVector<std::complex<float>> complexFFTRes;
+
+    // Batched rows: spectra with a padded stride and the SoA work area
+    AlignedVector<std::complex<float>> batchFFTRes;
+    AlignedVector<float> batchFFTWork;
+
+    // Widened taps * n samples of a filter bank row
+    AlignedVector<std::complex<float>> pfbInput;
+
+    // Bluestein convolution buffers of sizes other than 2^n
+    AlignedVector<std::complex<float>> mixedFFTWork;
+
+    // Cell values of the current row in params.scale
+    std::vector<float> rowValues;
+
+    // Power reduced over the transforms of a decimated row, FFT order
+    std::vector<float> rowPower;
+
+    // Int16 spectrum of the fixed-point path
+    std::vector<iq16_t> fixedFFTRes;
 
 public:
     ColorMapWorker(QObject * parent = nullptr) : QObject(parent) {
+        complexFFTIn.reserve(std::pow(2, 16));
         complexFFTRes.reserve(std::pow(2, 16));
     }
 
-    void connectTasks(std::vector<ColorMapWorkerTask *> * tskPool) {
+    void connectTasks(TaskQueue<std::shared_ptr<ColorMapWorkerTask>> * tskPool) {
         this->tasks = tskPool;
     }
 
+    void setParams(const ColorMapWorkerParams & newParams) {
+        this->params = newParams;
+    }
+
     float getMaxValue(void) {
         return maxValue;
     }
 
+    /**
+     * @brief Уровни ядер, выбранных по cpuLevel(), в порядке обработки строки
+     *
+     * Первое обращение выполняет выбор, поэтому вызывается при запуске,
+     * до первого прохода.
+     */
+    static std::vector<std::pair<const char *, CpuLevel>> kernelLevels(void) {
+        return {
+            {"conversion", iqConvertKernel().level},
+            {"FFT", fftKernel().level},
+            {"batched FFT", fftBatchKernel().level},
+            {"mixed radix", fftMixedKernels().level},
+            {"real unpack", fftRealUnpackKernel().level},
+            {"fixed-point FFT", fftFixedKernel().level},
+            {"PFB front end", pfbFoldKernel().level},
+            {"row output", spectrumKernel().level}
+        };
+    }
+
 public slots:
     bool startProcessing(void) {
         if (this->running.load() == false) {
-            maxValue = 0;
+            maxValue = -std::numeric_limits<float>::infinity();
             this->stopped.store(false);
             try {
                 this->executorThread = std::thread(std::bind(&ColorMapWorker::process, this));
@@ -115,52 +196,314 @@ protected:
 
         this->running.store(true);
 
-        size_t workIndex = 0;
+        std::shared_ptr<ColorMapWorkerTask> task;
 
         while (this->stopped.load() != true) {
 
-            if (workIndex == this->tasks->size()) {
+            if (!this->tasks->pop(task)) {
                 break;
             }
 
-            if (this->tasks->at(workIndex)->takeWork()) {
+            // Compressed chunks are unpacked by whichever worker takes them,
+            // so several chunks are decoded in parallel
+            if (task->prepare) {
+                task->signal = task->prepare();
+                if (task->signal == nullptr) {
+                    std::cerr << "Error on preparing chunk at row " << task->mapIndex << std::endl << std::flush;
+                    // Rows stay empty but still count towards completion
+                    for (size_t row = 0; row < task->rowsCount; row++) {
+                        emit this->Progress();
+                    }
+                    task.reset();
+                    continue;
+                }
+            }
+
+            // Sample format is resolved once per chunk, the row loop below
+            // is instantiated separately for every sample type
+            dispatchSampleFormat(task->format, [this, &task](auto sample) {
+                typedef decltype(sample) sample_t;
+                this->processTask(*task, reinterpret_cast<const sample_t *>(task->signal));
+            });
 
-                QCPColorMap * waterfallMap = this->tasks->at(workIndex)->targetMap;
+            // Dropping the task releases its chunk back to the streamer
+            task.reset();
+        }
 
-                if (complexFFTRes.size() != this->tasks->at(workIndex)->windowSize) {
-                    complexFFTRes.resize(this->tasks->at(workIndex)->windowSize);
-                }
+        this->running.store(false);
+
+    }
 
-                stdComplexFFT(this->tasks->at(workIndex)->signal->begin() + \
-                              this->tasks->at(workIndex)->mapIndex * this->tasks->at(workIndex)->step, \
-                              std::begin(complexFFTRes), std::log2(this->tasks->at(workIndex)->windowSize));
-
-                // Half replacements ===========================================
-                std::vector<std::complex<float>> tmp{std::begin(complexFFTRes), \
-                            std::begin(complexFFTRes) + complexFFTRes.size() / 2};
-                std::copy(std::begin(complexFFTRes) + complexFFTRes.size() / 2, \
-                          std::end(complexFFTRes), std::begin(complexFFTRes));
-                std::copy(std::begin(tmp), std::end(tmp), \
-                          std::begin(complexFFTRes) + tmp.size());
-                // =============================================================
-
-                std::for_each(std::begin(this->complexFFTRes), std::end(this->complexFFTRes), [this](const std::complex<float> & item) {
-                    float tmp = std::abs(item);
-                    if (this->maxValue < std::abs(item))
-                        this->maxValue = std::abs(item);
-                });
-
-                for (size_t l = 0; l < this->tasks->at(workIndex)->windowSize; l++) {
-                    waterfallMap->data()->setCell(l, this->tasks->at(workIndex)->mapIndex, std::abs(this->complexFFTRes.at(l)));
+    template<class Sample_T>
+    void processTask(ColorMapWorkerTask & task, const Sample_T * signal) {
+
+        if (complexFFTRes.size() != task.windowSize) {
+            complexFFTIn.resize(task.windowSize);
+            complexFFTRes.resize(task.windowSize);
+        }
+
+        const FFTBackendPlan * backend = this->params.backend;
+        const std::complex<float> dc = this->params.dcRemoval ? this->params.dcOffset : std::complex<float>(0, 0);
+        const float * window = this->params.window != nullptr ? this->params.window->values() : nullptr;
+        const size_t taps = this->params.window != nullptr ? this->params.window->taps() : 1;
+
+        if (!fftIsPow2(task.windowSize)) {
+            this->processMixed(task, signal, dc);
+            return;
+        }
+
+        // Shared read-only plan: twiddles and permutation are built once per size
+        const fftPlan_t & plan = fftPlan_t::get(std::log2(task.windowSize));
+
+        if constexpr (std::is_same<Sample_T, iq16_t>::value || std::is_same<Sample_T, r16pair_t>::value) {
+            if (this->params.fixedPoint && backend == nullptr && taps == 1 && plan.log2n() >= fftFixedMinOrder) {
+                // Real pairs have the iq16_t layout
+                this->processFixed(task, reinterpret_cast<const iq16_t *>(signal), dc);
+                return;
+            }
+        }
+
+        // Short windows leave vector registers mostly idle inside one row,
+        // so consecutive rows are transformed together, one row per lane
+        const size_t batch = fftBatchKernel().width;
+        const bool batched = backend == nullptr && taps == 1 && batch > 1 && plan.log2n() >= fftBatchMinOrder && \
+                plan.log2n() <= fftBatchKernel().maxOrder;
+        const size_t batchStride = fftBatchStride(task.windowSize);
+        if (batched && batchFFTRes.size() != batch * batchStride) {
+            batchFFTRes.resize(batch * batchStride);
+            batchFFTWork.resize(fftBatchWorkSize(task.windowSize, batch));
+        }
+
+        // Real records: the window of 2n real samples is transformed as n
+        // packed pairs and unpacked with the last stage of a 2n-point plan
+        const std::complex<float> * realTwiddles = nullptr;
+        if (sampleFormatIsReal(task.format)) {
+            realTwiddles = fftPlan_t::get(plan.log2n() + 1).stageTwiddles(task.windowSize);
+        }
+
+        // Decimated rows are runs of transforms at a constant hop, so the
+        // batched kernels take them as consecutive rows
+        const size_t hop = task.step / this->params.average;
+        const size_t transforms = task.rowsCount * this->params.average;
+
+        size_t transform = 0;
+        for (; batched && transform + batch <= transforms; transform += batch) {
+
+            if (this->stopped.load()) {
+                return;
+            }
+
+            fastComplexFFTBatch(signal + transform * hop, hop, dc, \
+                                batchFFTRes.data(), batchFFTWork.data(), plan, window);
+
+            for (size_t r = 0; r < batch; r++) {
+                this->storeRow(task, transform + r, batchFFTRes.data() + r * batchStride, realTwiddles);
+            }
+        }
+
+        for (; transform < transforms; transform++) {
+
+            if (this->stopped.load()) {
+                break;
+            }
+
+            const Sample_T * samples = signal + transform * hop;
+
+            if (taps > 1) {
+                // Filter bank rows: the folded taps are the transform input
+                this->pfbLoad(samples, task.windowSize, dc);
+                if (backend != nullptr) {
+                    backend->transform(complexFFTIn.data(), complexFFTRes.data());
+                } else {
+                    fastComplexFFT(complexFFTIn.data(), complexFFTRes.data(), plan);
                 }
+            } else if (backend != nullptr) {
+                // External libraries take widened samples only
+                sampleConvert(samples, complexFFTIn.data(), task.windowSize, 1.0f, dc, window);
+                backend->transform(complexFFTIn.data(), complexFFTRes.data());
+            } else if (this->params.dcRemoval) {
+                // Vectorized widening with DC subtraction and window in the same pass
+                sampleConvert(samples, complexFFTIn.data(), task.windowSize, 1.0f, this->params.dcOffset, window);
+                fastComplexFFT(complexFFTIn.data(), complexFFTRes.data(), plan);
+            } else {
+                // Samples are widened and windowed inside the FFT load stage
+                fastComplexFFT(samples, complexFFTRes.data(), plan, window);
+            }
 
-                emit this->Progress();
+            this->storeRow(task, transform, complexFFTRes.data(), realTwiddles);
+        }
+    }
+
+    /**
+     * @brief Строки с размером окна, отличным от степени двойки
+     *
+     * Смешанное основание 2/3/5/7 либо Bluestein (FFTMixedPlan), строки
+     * по одной: пакетные ядра и слияние с загрузкой есть только у 2^n.
+     */
+    template<class Sample_T>
+    void processMixed(ColorMapWorkerTask & task, const Sample_T * signal, std::complex<float> dc) {
+
+        const FFTMixedPlan & plan = FFTMixedPlan::get(task.windowSize);
+        if (mixedFFTWork.size() < plan.workSize()) {
+            mixedFFTWork.resize(plan.workSize());
+        }
+
+        const FFTBackendPlan * backend = this->params.backend;
+        const float * window = this->params.window != nullptr ? this->params.window->values() : nullptr;
+
+        const std::complex<float> * realTwiddles = nullptr;
+        if (sampleFormatIsReal(task.format)) {
+            realTwiddles = plan.halfTwiddles();
+        }
+
+        const size_t hop = task.step / this->params.average;
+        const size_t transforms = task.rowsCount * this->params.average;
+
+        for (size_t transform = 0; transform < transforms; transform++) {
+
+            if (this->stopped.load()) {
+                break;
             }
-            workIndex++;
+
+            if (this->params.window != nullptr && this->params.window->taps() > 1) {
+                this->pfbLoad(signal + transform * hop, task.windowSize, dc);
+            } else {
+                sampleConvert(signal + transform * hop, complexFFTIn.data(), task.windowSize, 1.0f, dc, window);
+            }
+            if (backend != nullptr) {
+                backend->transform(complexFFTIn.data(), complexFFTRes.data());
+            } else {
+                plan.transform(complexFFTIn.data(), complexFFTRes.data(), mixedFFTWork.data());
+            }
+
+            this->storeRow(task, transform, complexFFTRes.data(), realTwiddles);
         }
+    }
 
-        this->running.store(false);
+    /**
+     * @brief Вход строки банка фильтров в complexFFTIn
+     *
+     * taps * n отсчётов расширяются во float, взвешиваются прототипом
+     * params.window и складываются блоками по n (pfbFold).
+     */
+    template<class Sample_T>
+    void pfbLoad(const Sample_T * samples, size_t n, std::complex<float> dc) {
+        const size_t taps = this->params.window->taps();
+        if (pfbInput.size() != taps * n) {
+            pfbInput.resize(taps * n);
+        }
+        sampleConvert(samples, pfbInput.data(), taps * n, 1.0f, dc);
+        pfbFold(reinterpret_cast<const float *>(pfbInput.data()), this->params.window->values(), taps, 2 * n, \
+                reinterpret_cast<float *>(complexFFTIn.data()));
+    }
+
+    /**
+     * @brief Строки int16 в блочной плавающей точке (быстрый просмотр)
+     *
+     * Спектр строки расширяется во float с множителем 2^exponent, дальше
+     * строка выводится как обычно, включая распаковку вещественной записи.
+     */
+    void processFixed(ColorMapWorkerTask & task, const iq16_t * signal, std::complex<float> dc) {
+
+        const FFTFixedPlan & plan = FFTFixedPlan::get(std::log2(task.windowSize));
+        if (fixedFFTRes.size() != task.windowSize) {
+            fixedFFTRes.resize(task.windowSize);
+        }
+
+        const std::complex<float> * realTwiddles = nullptr;
+        if (sampleFormatIsReal(task.format)) {
+            realTwiddles = fftPlan_t::get(plan.base().log2n() + 1).stageTwiddles(task.windowSize);
+        }
+
+        // Q15 window is not divided by the coherent gain, the correction joins the block scale
+        const int16_t * window = nullptr;
+        float gain = 1.0f;
+        if (this->params.window != nullptr && this->params.window->fixedValues() != nullptr) {
+            window = this->params.window->fixedValues();
+            gain = (float)(1.0 / this->params.window->coherentGain());
+        }
+
+        const size_t hop = task.step / this->params.average;
+        const size_t transforms = task.rowsCount * this->params.average;
+
+        for (size_t transform = 0; transform < transforms; transform++) {
+
+            if (this->stopped.load()) {
+                break;
+            }
+
+            const int exponent = fastFixedFFT(signal + transform * hop, fixedFFTRes.data(), plan, dc, window);
+            iqConvert(fixedFFTRes.data(), complexFFTRes.data(), task.windowSize, std::ldexp(gain, exponent));
+
+            this->storeRow(task, transform, complexFFTRes.data(), realTwiddles);
+        }
+    }
+
+    /**
+     * @brief Перенос спектра в строку карты
+     *
+     * Без прореживания спектр сразу выводится в строку transform; иначе его
+     * мощность сворачивается (params.reduce), и строка transform / average
+     * выводится по последнему из её спектров.
+     * @param task Текущая задача
+     * @param transform Номер преобразования внутри задачи
+     * @param spectrum Спектр в порядке бинов FFT, task.windowSize значений
+     * @param realTwiddles Множители fftRealUnpack для вещественной записи,
+     * nullptr - комплексная запись
+     */
+    void storeRow(ColorMapWorkerTask & task, size_t transform, const std::complex<float> * spectrum, \
+                  const std::complex<float> * realTwiddles) {
+
+        const size_t size = task.windowSize;
+        const size_t average = this->params.average;
+
+        if (this->rowValues.size() != size) {
+            this->rowValues.resize(size);
+        }
+        float * values = this->rowValues.data();
+        const SpectrumScale scale = this->params.scale;
+
+        if (realTwiddles != nullptr) {
+            // Half spectrum [0, Fs / 2) is already in display order
+            fftRealUnpack(spectrum, complexFFTIn.data(), realTwiddles, size);
+            spectrum = complexFFTIn.data();
+        }
+
+        // Half replacement of complex records is folded into the row
+        // write-out: bins [h, n) go to the left half, [0, h) to the right.
+        // Odd sizes: DC and the positive bins are the longer half, so that
+        // DC lands on n / 2
+        const size_t h = realTwiddles != nullptr ? 0 : size - size / 2;
+
+        float rowMax = 0;
+        if (average == 1) {
+            rowMax = std::max(spectrumRow(spectrum + h, values, size - h, scale), \
+                              spectrumRow(spectrum, values + size - h, h, scale));
+        } else {
+            if (this->rowPower.size() != size) {
+                this->rowPower.resize(size);
+            }
+            float * power = this->rowPower.data();
+            const SpectrumReduce reduce = this->params.reduce;
+            if (transform % average == 0) {
+                std::fill(power, power + size, spectrumReduceInit(reduce));
+            }
+            spectrumAccumulate(spectrum, power, size, reduce);
+            if (transform % average != average - 1) {
+                return;
+            }
+            const float gain = reduce == SpectrumReduce_Mean ? 1.0f / average : 1.0f;
+            rowMax = std::max(spectrumPowerRow(power + h, gain, values, size - h, scale), \
+                              spectrumPowerRow(power, gain, values + size - h, h, scale));
+        }
+        this->maxValue = std::max(this->maxValue, rowMax);
+
+        const size_t row = transform / average;
+        for (size_t l = 0; l < size; l++) {
+            task.targetMap->data()->setCell(l, task.mapIndex + row, values[l]);
+        }
 
+        emit this->Progress();
     }
 };
 
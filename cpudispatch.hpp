@@ -0,0 +1,113 @@
+#ifndef CPUDISPATCH_HPP
+#define CPUDISPATCH_HPP
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IQCONVERT_X86
+#endif
+
+// =============================================================================
+// Runtime CPU dispatch
+// =============================================================================
+//
+// The project is built without ISA flags, so one binary runs on any x86-64
+// machine. Vector kernels are compiled per instruction set with target
+// attributes, and every kernel family picks its widest variant not above
+// cpuLevel(). The level is detected once, from CPUID, and may be capped
+// from the settings to compare the paths on one machine.
+
+enum CpuLevel {
+    CpuLevel_Scalar = 0,
+    CpuLevel_SSE2,
+    CpuLevel_SSE41,
+    // AVX2 together with FMA
+    CpuLevel_AVX2,
+    // AVX-512F on top of AVX2 and FMA
+    CpuLevel_AVX512
+};
+
+/**
+ * @brief Ядро семейства с уровнем, для которого оно собрано
+ */
+template<class Func_T>
+struct CpuKernel {
+    Func_T func{nullptr};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+inline const char * cpuLevelName(CpuLevel level)
+{
+    switch (level) {
+    case CpuLevel_SSE2: return "sse2";
+    case CpuLevel_SSE41: return "sse4.1";
+    case CpuLevel_AVX2: return "avx2";
+    case CpuLevel_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+/**
+ * @brief Уровень по имени (cpuLevelName()), fallback для неизвестных имён
+ */
+inline CpuLevel cpuLevelParse(const char * name, CpuLevel fallback)
+{
+    for (int level = CpuLevel_Scalar; level <= CpuLevel_AVX512; level++) {
+        if (std::strcmp(name, cpuLevelName((CpuLevel)level)) == 0) {
+            return (CpuLevel)level;
+        }
+    }
+    return fallback;
+}
+
+/**
+ * @brief Наибольший уровень, поддерживаемый процессором
+ */
+inline CpuLevel cpuLevelDetect(void)
+{
+#ifdef IQCONVERT_X86
+    __builtin_cpu_init();
+    const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (avx2 && __builtin_cpu_supports("avx512f"))
+        return CpuLevel_AVX512;
+    if (avx2)
+        return CpuLevel_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return CpuLevel_SSE41;
+    if (__builtin_cpu_supports("sse2"))
+        return CpuLevel_SSE2;
+#endif
+    return CpuLevel_Scalar;
+}
+
+inline CpuLevel & cpuLevelCap(void)
+{
+    static CpuLevel cap = CpuLevel_AVX512;
+    return cap;
+}
+
+/**
+ * @brief Ограничение уровня сверху
+ *
+ * Действует только до первого обращения к cpuLevel(), то есть до выбора
+ * первого ядра; вызывается из потока интерфейса при запуске.
+ */
+inline void cpuLevelLimit(CpuLevel cap)
+{
+    cpuLevelCap() = cap;
+}
+
+/**
+ * @brief Уровень, по которому выбираются все ядра, определяется один раз
+ */
+inline CpuLevel cpuLevel(void)
+{
+    static const CpuLevel level = std::min(cpuLevelDetect(), cpuLevelCap());
+    return level;
+}
+
+// =============================================================================
+
+#endif // CPUDISPATCH_HPP
@@ -5,12 +5,32 @@ CustomToolBar::CustomToolBar(QObject *parent) : QObject(parent) {
     this->sampleRate->setText("1100e6");
     this->fftOrder = new QLineEdit();
     this->fftOrder->setText("10");
+    this->fftOrder->setToolTip("FFT order n (2^n points) up to 30, or FFT size in points above it");
     this->scaleFactor = new QLineEdit();
     this->scaleFactor->setText("0.1");
+    this->averageCount = new QLineEdit();
+    this->averageCount->setText("1");
+    this->averageCount->setToolTip("Transforms per row (Welch): every row is their mean power, rows are this many times fewer");
+    this->pfbTaps = new QLineEdit();
+    this->pfbTaps->setText("1");
+    this->pfbTaps->setToolTip("Polyphase filter bank taps per channel: 1 is the plain windowed FFT, 4-8 suppress leakage between bins");
+    // Index 0 picks the format from the file extension, others follow SampleFormat
+    this->sampleFormat = new QComboBox();
+    this->sampleFormat->addItems({"Auto", "cs8", "cu8", "cs16", "cs16 BE", "cf32", "cf64", "rs16 (real)"});
+    // Time range of the record to process, zero length means up to the end
+    this->timeOffset = new QLineEdit();
+    this->timeOffset->setText("0");
+    this->timeLength = new QLineEdit();
+    this->timeLength->setText("0");
 
     connect(sampleRate, &QLineEdit::textChanged, this, &CustomToolBar::onSampleRate_TextChanged);
     connect(fftOrder, &QLineEdit::textChanged, this, &CustomToolBar::onFFTOrder_TextChanged);
     connect(scaleFactor, &QLineEdit::textChanged, this, &CustomToolBar::onScaleFactor_TextChanged);
+    connect(averageCount, &QLineEdit::textChanged, this, &CustomToolBar::onAverageCount_TextChanged);
+    connect(pfbTaps, &QLineEdit::textChanged, this, &CustomToolBar::onPFBTaps_TextChanged);
+    connect(sampleFormat, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &CustomToolBar::onSampleFormat_IndexChanged);
+    connect(timeOffset, &QLineEdit::textChanged, this, &CustomToolBar::onTimeOffset_TextChanged);
+    connect(timeLength, &QLineEdit::textChanged, this, &CustomToolBar::onTimeLength_TextChanged);
 }
 
 CustomToolBar::~CustomToolBar() {}
@@ -19,15 +39,41 @@ void CustomToolBar::draw(QToolBar *rootBar) {
     rootBar->addWidget(new QLabel("Sample rate"));
     rootBar->addWidget(this->sampleRate);
     rootBar->addSeparator();
-    rootBar->addWidget(new QLabel("FFT order"));
+    rootBar->addWidget(new QLabel("FFT order/size"));
     rootBar->addWidget(this->fftOrder);
+    rootBar->addWidget(new QLabel("PFB taps"));
+    rootBar->addWidget(this->pfbTaps);
     rootBar->addSeparator();
     rootBar->addWidget(new QLabel("Scale factor"));
     rootBar->addWidget(this->scaleFactor);
+    rootBar->addWidget(new QLabel("Averaging"));
+    rootBar->addWidget(this->averageCount);
+    rootBar->addSeparator();
+    rootBar->addWidget(new QLabel("Sample format"));
+    rootBar->addWidget(this->sampleFormat);
+    rootBar->addSeparator();
+    rootBar->addWidget(new QLabel("Offset, s"));
+    rootBar->addWidget(this->timeOffset);
+    rootBar->addWidget(new QLabel("Length, s"));
+    rootBar->addWidget(this->timeLength);
 }
 
 void CustomToolBar::emitAll() {
     emit this->sampleRate->textChanged(sampleRate->text());
     emit this->fftOrder->textChanged(fftOrder->text());
     emit this->scaleFactor->textChanged(scaleFactor->text());
+    emit this->averageCount->textChanged(averageCount->text());
+    emit this->pfbTaps->textChanged(pfbTaps->text());
+    emit this->sampleFormat->currentIndexChanged(sampleFormat->currentIndex());
+    emit this->timeOffset->textChanged(timeOffset->text());
+    emit this->timeLength->textChanged(timeLength->text());
+}
+
+void CustomToolBar::setSampleRate(const QString &text) {
+    this->sampleRate->setText(text);
+}
+
+void CustomToolBar::setTimeRange(double offset, double length) {
+    this->timeOffset->setText(QString::number(offset, 'g', 12));
+    this->timeLength->setText(QString::number(length, 'g', 12));
 }
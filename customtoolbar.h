@@ -5,6 +5,7 @@
 #include <QToolBar>
 #include <QLabel>
 #include <QLineEdit>
+#include <QComboBox>
 
 class CustomToolBar : public QObject {
     Q_OBJECT
@@ -12,6 +13,11 @@ class CustomToolBar : public QObject {
     QLineEdit * sampleRate;
     QLineEdit * fftOrder;
     QLineEdit * scaleFactor;
+    QLineEdit * averageCount;
+    QLineEdit * pfbTaps;
+    QComboBox * sampleFormat;
+    QLineEdit * timeOffset;
+    QLineEdit * timeLength;
 
 public:
     CustomToolBar(QObject * parent);
@@ -21,10 +27,18 @@ public:
 
     void emitAll(void);
 
+    void setSampleRate(const QString & text);
+    void setTimeRange(double offset, double length);
+
 signals:
     void onSampleRate_TextChanged(const QString & text);
     void onFFTOrder_TextChanged(const QString & text);
     void onScaleFactor_TextChanged(const QString & text);
+    void onAverageCount_TextChanged(const QString & text);
+    void onPFBTaps_TextChanged(const QString & text);
+    void onSampleFormat_IndexChanged(int index);
+    void onTimeOffset_TextChanged(const QString & text);
+    void onTimeLength_TextChanged(const QString & text);
 
 protected:
 
@@ -0,0 +1,461 @@
+#ifndef DDC_HPP
+#define DDC_HPP
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "cpudispatch.hpp"
+#include "sampleformat.hpp"
+#include "fftkernel.hpp"
+#include "window.hpp"
+
+// =============================================================================
+// Zoom band: digital downconversion and decimation
+// =============================================================================
+//
+// A band of the record is mixed to zero frequency by a numerically
+// controlled oscillator, low-pass filtered and decimated by D, and the
+// narrowband stream is written as a cf32 record of its own. Resolving the
+// band with the same FFT then costs a D times shorter record instead of a
+// D times larger FFT order over the full rate.
+//
+// NCO: a 32-bit phase accumulator, e^-j phase from two 1024-entry tables
+// (coarse phase bits 31..22 times fine bits 21..12, the fine entries taken at
+// the middle of their 2^12 step), so the phase error is below pi / 2^20 and
+// the spurs stay under -110 dBc. The table value is looked up once per
+// ddcNcoBlock samples; inside a block the oscillator is that value times a
+// rotation table e^-j k phaseStep, so mixing is two vector complex products
+// per sample and the phase never drifts: every block restarts from the
+// accumulator. The phase of a sample is sample * phaseStep mod 2^32, hence
+// chunks of the record are mixed independently and in any order.
+//
+// Filter: Kaiser-windowed sinc, unity gain at DC, only every D-th output is
+// computed, which is the cost of the polyphase form: length / D
+// multiply-adds per input sample. Output m is the dot product of the taps
+// with inputs [m D, m D + length), real taps over interleaved {re, im}
+// pairs, so the kernels are plain float dot products. Taps are zero-padded
+// to ddcTapsAlign complex values, one AVX-512 register.
+//
+// Real records are mixed as real samples at the full rate, the analytic
+// band [0, Fs / 2) maps to the output the same way as a complex one.
+
+// Samples mixed from one table lookup
+static constexpr size_t ddcNcoBlock = 64;
+static constexpr size_t ddcTapsAlign = 8;
+// Input samples of one chunk, per thread
+static constexpr size_t ddcChunkSamples = 1 << 20;
+// Output rate over the band width; the excess is the transition band
+static constexpr double ddcOversample = 1.5;
+static constexpr double ddcAttenuation = 80.0;
+
+/**
+ * @brief Табличный NCO: e^-j phase по 32-битной фазе
+ */
+class DDCOscillator {
+protected:
+    std::vector<std::complex<float>> coarse;
+    std::vector<std::complex<float>> fine;
+    std::vector<std::complex<float>> rotation;
+    uint32_t phaseStep{0};
+
+public:
+    /**
+     * @param frequency Частота, переносимая на ноль, в долях частоты дискретизации
+     */
+    explicit DDCOscillator(double frequency) : coarse(1024), fine(1024), rotation(ddcNcoBlock) {
+        const double turn = 4294967296.0;
+        const double wrapped = frequency - std::floor(frequency);
+        this->phaseStep = (uint32_t)(uint64_t)std::llround(wrapped * turn);
+
+        for (size_t k = 0; k < 1024; k++) {
+            this->coarse[k] = std::polar(1.0f, (float)(-2.0 * M_PI * (double)k / 1024.0));
+            const double finePhase = -2.0 * M_PI * ((double)k + 0.5) / 1048576.0;
+            this->fine[k] = std::complex<float>(std::polar(1.0, finePhase));
+        }
+        for (size_t k = 0; k < ddcNcoBlock; k++) {
+            const double phase = -2.0 * M_PI * std::fmod((double)this->phaseStep * (double)k, turn) / turn;
+            this->rotation[k] = std::complex<float>(std::polar(1.0, phase));
+        }
+    }
+
+    /**
+     * @brief Фаза отсчёта sample записи
+     */
+    uint32_t phase(uint64_t sample) const {
+        return (uint32_t)(sample * this->phaseStep);
+    }
+
+    std::complex<float> at(uint32_t phase) const {
+        return this->coarse[phase >> 22] * this->fine[(phase >> 12) & 1023];
+    }
+
+    /**
+     * @brief Фактическая частота NCO в долях частоты дискретизации, [-0.5, 0.5)
+     */
+    double frequency(void) const {
+        return (double)(int32_t)this->phaseStep / 4294967296.0;
+    }
+
+    const std::complex<float> * rotations(void) const {
+        return this->rotation.data();
+    }
+};
+
+/**
+ * @brief Сигнатура ядра смесителя: x[i] *= bases[i / ddcNcoBlock] * rotation[i % ddcNcoBlock]
+ */
+typedef void (*ddcMixFunc_t)(std::complex<float> * x, size_t n, const std::complex<float> * bases, \
+                             const std::complex<float> * rotation);
+
+/**
+ * @brief Сигнатура ядра фильтра: out[m] = sum taps[j] x[m stride + j], j < length
+ * @param taps 2 length множителей {h, h}, length кратно ddcTapsAlign
+ */
+typedef void (*ddcFilterFunc_t)(const std::complex<float> * x, size_t stride, const float * taps, size_t length, \
+                                std::complex<float> * out, size_t count);
+
+// Scalar ======================================================================
+
+inline void ddcMixScalar(std::complex<float> * x, size_t n, const std::complex<float> * bases, \
+                         const std::complex<float> * rotation)
+{
+    for (size_t i = 0; i < n; i++) {
+        x[i] *= bases[i / ddcNcoBlock] * rotation[i % ddcNcoBlock];
+    }
+}
+
+inline void ddcFilterScalar(const std::complex<float> * x, size_t stride, const float * taps, size_t length, \
+                            std::complex<float> * out, size_t count)
+{
+    for (size_t m = 0; m < count; m++) {
+        const float * p = reinterpret_cast<const float *>(x + m * stride);
+        float re = 0.0f, im = 0.0f;
+        for (size_t j = 0; j < 2 * length; j += 2) {
+            re += p[j] * taps[j];
+            im += p[j + 1] * taps[j + 1];
+        }
+        out[m] = {re, im};
+    }
+}
+
+#ifdef IQCONVERT_X86
+// Vector mixers take the oscillator of a block as the broadcast base times
+// the rotation table, the complex products are the FFT ones. Filters keep
+// two accumulators of interleaved {re, im} lanes and fold them at the end
+
+// SSE4.1 ======================================================================
+
+__attribute__((target("sse4.1")))
+inline void ddcMixSSE41(std::complex<float> * x, size_t n, const std::complex<float> * bases, \
+                        const std::complex<float> * rotation)
+{
+    float * d = reinterpret_cast<float *>(x);
+    const float * r = reinterpret_cast<const float *>(rotation);
+    size_t i = 0;
+    for (; i + ddcNcoBlock <= n; i += ddcNcoBlock) {
+        const __m128 base = _mm_setr_ps(bases[i / ddcNcoBlock].real(), bases[i / ddcNcoBlock].imag(), \
+                                        bases[i / ddcNcoBlock].real(), bases[i / ddcNcoBlock].imag());
+        for (size_t k = 0; k < ddcNcoBlock; k += 2) {
+            const __m128 oscillator = fftMulSSE41(_mm_loadu_ps(r + 2 * k), base);
+            _mm_storeu_ps(d + 2 * (i + k), fftMulSSE41(_mm_loadu_ps(d + 2 * (i + k)), oscillator));
+        }
+    }
+    ddcMixScalar(x + i, n - i, bases + i / ddcNcoBlock, rotation);
+}
+
+__attribute__((target("sse4.1")))
+inline void ddcFilterSSE41(const std::complex<float> * x, size_t stride, const float * taps, size_t length, \
+                           std::complex<float> * out, size_t count)
+{
+    for (size_t m = 0; m < count; m++) {
+        const float * p = reinterpret_cast<const float *>(x + m * stride);
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (size_t j = 0; j < 2 * length; j += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(p + j), _mm_loadu_ps(taps + j)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(p + j + 4), _mm_loadu_ps(taps + j + 4)));
+        }
+        const __m128 acc = _mm_add_ps(acc0, acc1);
+        _mm_storel_pi(reinterpret_cast<__m64 *>(out + m), _mm_add_ps(acc, _mm_movehl_ps(acc, acc)));
+    }
+}
+
+// AVX2 ========================================================================
+
+__attribute__((target("avx2,fma")))
+inline void ddcMixAVX2(std::complex<float> * x, size_t n, const std::complex<float> * bases, \
+                       const std::complex<float> * rotation)
+{
+    float * d = reinterpret_cast<float *>(x);
+    const float * r = reinterpret_cast<const float *>(rotation);
+    size_t i = 0;
+    for (; i + ddcNcoBlock <= n; i += ddcNcoBlock) {
+        const __m256 base = _mm256_castpd_ps(_mm256_broadcast_sd(reinterpret_cast<const double *>(bases + i / ddcNcoBlock)));
+        for (size_t k = 0; k < ddcNcoBlock; k += 4) {
+            const __m256 oscillator = fftMulAVX2(_mm256_loadu_ps(r + 2 * k), base);
+            _mm256_storeu_ps(d + 2 * (i + k), fftMulAVX2(_mm256_loadu_ps(d + 2 * (i + k)), oscillator));
+        }
+    }
+    ddcMixScalar(x + i, n - i, bases + i / ddcNcoBlock, rotation);
+}
+
+__attribute__((target("avx2,fma")))
+inline void ddcFilterAVX2(const std::complex<float> * x, size_t stride, const float * taps, size_t length, \
+                          std::complex<float> * out, size_t count)
+{
+    for (size_t m = 0; m < count; m++) {
+        const float * p = reinterpret_cast<const float *>(x + m * stride);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (size_t j = 0; j < 2 * length; j += 16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(p + j), _mm256_loadu_ps(taps + j), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(p + j + 8), _mm256_loadu_ps(taps + j + 8), acc1);
+        }
+        const __m256 acc = _mm256_add_ps(acc0, acc1);
+        const __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(out + m), _mm_add_ps(half, _mm_movehl_ps(half, half)));
+    }
+}
+
+// AVX-512 =====================================================================
+
+__attribute__((target("avx512f,avx2,fma")))
+inline void ddcMixAVX512(std::complex<float> * x, size_t n, const std::complex<float> * bases, \
+                         const std::complex<float> * rotation)
+{
+    float * d = reinterpret_cast<float *>(x);
+    const float * r = reinterpret_cast<const float *>(rotation);
+    size_t i = 0;
+    for (; i + ddcNcoBlock <= n; i += ddcNcoBlock) {
+        const __m512 base = _mm512_castpd_ps(_mm512_set1_pd(*reinterpret_cast<const double *>(bases + i / ddcNcoBlock)));
+        for (size_t k = 0; k < ddcNcoBlock; k += 8) {
+            const __m512 oscillator = fftMulAVX512(_mm512_loadu_ps(r + 2 * k), base);
+            _mm512_storeu_ps(d + 2 * (i + k), fftMulAVX512(_mm512_loadu_ps(d + 2 * (i + k)), oscillator));
+        }
+    }
+    ddcMixScalar(x + i, n - i, bases + i / ddcNcoBlock, rotation);
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+inline void ddcFilterAVX512(const std::complex<float> * x, size_t stride, const float * taps, size_t length, \
+                            std::complex<float> * out, size_t count)
+{
+    for (size_t m = 0; m < count; m++) {
+        const float * p = reinterpret_cast<const float *>(x + m * stride);
+        __m512 acc = _mm512_setzero_ps();
+        for (size_t j = 0; j < 2 * length; j += 16) {
+            acc = _mm512_fmadd_ps(_mm512_loadu_ps(p + j), _mm512_loadu_ps(taps + j), acc);
+        }
+        const __m256 quarter = _mm256_add_ps(_mm512_castps512_ps256(acc), \
+                                             _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(acc), 1)));
+        const __m128 half = _mm_add_ps(_mm256_castps256_ps128(quarter), _mm256_extractf128_ps(quarter, 1));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(out + m), _mm_add_ps(half, _mm_movehl_ps(half, half)));
+    }
+}
+#endif
+
+// Dispatch ====================================================================
+
+struct DDCKernel {
+    ddcMixFunc_t mix{nullptr};
+    ddcFilterFunc_t filter{nullptr};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+inline DDCKernel ddcSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512)
+        return {ddcMixAVX512, ddcFilterAVX512, CpuLevel_AVX512};
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return {ddcMixAVX2, ddcFilterAVX2, CpuLevel_AVX2};
+    if (cpuLevel() >= CpuLevel_SSE41)
+        return {ddcMixSSE41, ddcFilterSSE41, CpuLevel_SSE41};
+#endif
+    return {ddcMixScalar, ddcFilterScalar, CpuLevel_Scalar};
+}
+
+inline const DDCKernel & ddcKernel(void)
+{
+    static const DDCKernel kernel = ddcSelect();
+    return kernel;
+}
+
+/**
+ * @brief Параметры понижающего преобразования полосы
+ *
+ * Частоты задаются в долях входной частоты дискретизации. Коэффициент
+ * децимации выбирается так, чтобы выходная частота была не меньше
+ * ddcOversample ширин полосы; полоса пропускания - половина ширины,
+ * задерживание начинается там, где выход начинает наламываться на неё.
+ */
+class DDCPlan {
+protected:
+    DDCOscillator nco;
+    size_t factor{1};
+    size_t tapsCount{0};
+    std::vector<float> table;
+
+public:
+    DDCPlan(double frequency, double bandwidth) : nco(frequency) {
+        bandwidth = std::min(1.0, std::max(bandwidth, 1e-9));
+        this->factor = std::max<size_t>(1, (size_t)std::floor(1.0 / (ddcOversample * bandwidth)));
+
+        const double pass = bandwidth / 2.0;
+        const double stop = std::max(pass, std::min(0.5, 1.0 / (double)this->factor - pass));
+        const double transition = std::max(stop - pass, 1e-3 / (double)this->factor);
+        const double cutoff = (pass + stop) / 2.0;
+
+        // Kaiser design: length and beta for the attenuation over the transition band
+        const size_t length = (size_t)std::ceil((ddcAttenuation - 7.95) / (14.36 * transition)) + 1;
+        const double beta = 0.1102 * (ddcAttenuation - 8.7);
+        this->tapsCount = (length + ddcTapsAlign - 1) / ddcTapsAlign * ddcTapsAlign;
+
+        std::vector<double> h(length);
+        double sum = 0;
+        for (size_t k = 0; k < length; k++) {
+            const double t = (double)k - (double)(length - 1) / 2.0;
+            const double sinc = t == 0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+            h[k] = sinc * (length > 1 ? windowValue(WindowFunction_Kaiser, k, length - 1, beta) : 1.0);
+            sum += h[k];
+        }
+
+        // Duplicated {h, h} pairs, zero tail up to the aligned length
+        this->table.assign(2 * this->tapsCount, 0.0f);
+        for (size_t k = 0; k < length; k++) {
+            this->table[2 * k] = this->table[2 * k + 1] = (float)(h[k] / sum);
+        }
+    }
+
+    const DDCOscillator & oscillator(void) const {
+        return this->nco;
+    }
+
+    size_t decimation(void) const {
+        return this->factor;
+    }
+
+    /**
+     * @brief Длина фильтра с выравниванием (кратна ddcTapsAlign)
+     */
+    size_t length(void) const {
+        return this->tapsCount;
+    }
+
+    const float * taps(void) const {
+        return this->table.data();
+    }
+
+    /**
+     * @brief Количество выходных отсчётов для count входных
+     */
+    uint64_t outputCount(uint64_t count) const {
+        return count < this->tapsCount ? 0 : (count - this->tapsCount) / this->factor + 1;
+    }
+};
+
+/**
+ * @brief Перенос, фильтрация и децимация полосы записи в файл cf32
+ *
+ * Выходные отсчёты делятся на порции по ddcChunkSamples входных, порции
+ * обрабатываются пакетами по числу потоков и записываются по порядку.
+ * @param src Отображённая запись
+ * @param format Формат записи
+ * @param first Первый входной отсчёт (для вещественных записей - вещественный)
+ * @param count Количество входных отсчётов
+ * @param path Путь к создаваемому файлу cf32
+ * @param stop Флаг досрочной остановки
+ * @return Количество записанных отсчётов либо 0 при ошибке
+ */
+inline uint64_t ddcWrite(const uint8_t * src, SampleFormat format, uint64_t first, uint64_t count, \
+                         const DDCPlan & plan, const std::string & path, const std::atomic_bool & stop)
+{
+    const uint64_t total = plan.outputCount(count);
+    if (src == nullptr || total == 0) {
+        return 0;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    const DDCKernel & kernel = ddcKernel();
+    const DDCOscillator & nco = plan.oscillator();
+    const size_t factor = plan.decimation();
+    const size_t length = plan.length();
+    const bool real = sampleFormatIsReal(format);
+
+    const size_t chunkOutputs = std::max<size_t>(1, ddcChunkSamples / factor);
+    const uint64_t chunks = (total + chunkOutputs - 1) / chunkOutputs;
+    const size_t chunkInputs = (chunkOutputs - 1) * factor + length;
+
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    // One spare sample: real chunks may start at the odd half of a pair
+    std::vector<std::vector<std::complex<float>>> input(threads, std::vector<std::complex<float>>(chunkInputs + 1));
+    std::vector<std::vector<std::complex<float>>> bases(threads, std::vector<std::complex<float>>(chunkInputs / ddcNcoBlock + 1));
+    std::vector<std::vector<std::complex<float>>> output(threads, std::vector<std::complex<float>>(chunkOutputs));
+    std::vector<size_t> outputSize(threads);
+
+    for (uint64_t batch = 0; batch < chunks; batch += threads) {
+        if (stop.load()) {
+            return 0;
+        }
+        const size_t batchSize = std::min<uint64_t>(threads, chunks - batch);
+
+        std::vector<std::thread> converters;
+        for (size_t t = 0; t < batchSize; t++) {
+            converters.emplace_back([&, t]() {
+                const uint64_t firstOutput = (batch + t) * chunkOutputs;
+                const size_t outputs = std::min<uint64_t>(chunkOutputs, total - firstOutput);
+                const size_t inputs = (outputs - 1) * factor + length;
+                const uint64_t sample = first + firstOutput * factor;
+                std::complex<float> * x = input[t].data();
+
+                if (real) {
+                    // Pairs hold consecutive real samples, widened in place from the end
+                    const uint64_t pair = sample / 2;
+                    const size_t odd = sample % 2;
+                    const size_t pairs = (odd + inputs + 1) / 2;
+                    sampleConvert(reinterpret_cast<const r16pair_t *>(src) + pair, x, pairs, 1.0f, {0, 0});
+                    const float * values = reinterpret_cast<const float *>(x);
+                    for (size_t i = inputs; i-- > 0;) {
+                        x[i] = {values[i + odd], 0.0f};
+                    }
+                } else {
+                    dispatchSampleFormat(format, [&](auto tag) {
+                        sampleConvert(reinterpret_cast<const decltype(tag) *>(src) + sample, x, inputs, 1.0f, {0, 0});
+                    });
+                }
+
+                std::complex<float> * blockBases = bases[t].data();
+                for (size_t b = 0; b * ddcNcoBlock < inputs; b++) {
+                    blockBases[b] = nco.at(nco.phase(sample + b * ddcNcoBlock));
+                }
+                kernel.mix(x, inputs, blockBases, nco.rotations());
+                kernel.filter(x, factor, plan.taps(), length, output[t].data(), outputs);
+                outputSize[t] = outputs;
+            });
+        }
+        for (std::thread & converter : converters) {
+            converter.join();
+        }
+
+        for (size_t t = 0; t < batchSize; t++) {
+            file.write(reinterpret_cast<const char *>(output[t].data()), outputSize[t] * sizeof (std::complex<float>));
+        }
+    }
+
+    return file.good() ? total : 0;
+}
+
+// =============================================================================
+
+#endif // DDC_HPP
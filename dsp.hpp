@@ -4,6 +4,12 @@
 #include <complex>
 #include <cmath>
 #include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <new>
 
 // int16_t iq
 typedef struct {
@@ -11,8 +17,79 @@ typedef struct {
     int16_t Q;
 } iq16_t;
 
+// int8_t iq
+typedef struct {
+    int8_t I;
+    int8_t Q;
+} iq8_t;
+
+// uint8_t iq (RTL-SDR, zero level 127.5)
+typedef struct {
+    uint8_t I;
+    uint8_t Q;
+} iqu8_t;
+
+// big-endian int16_t iq, stored as raw bytes
+typedef struct {
+    uint16_t I;
+    uint16_t Q;
+} iq16be_t;
+
+// two consecutive real int16_t samples, packed as one complex value
+// (even sample - real part, odd sample - imaginary part)
+typedef struct {
+    int16_t even;
+    int16_t odd;
+} r16pair_t;
+
+static inline int16_t swap16(uint16_t x) {
+    return (int16_t)((x >> 8) | (x << 8));
+}
+
 #define pow2(x) (uint32_t)(0x1 << x)
 
+/**
+ * @brief Аллокатор с выравниванием Alignment байт
+ *
+ * Рабочие буферы строк выровнены по строке кэша: векторные загрузки не
+ * пересекают её границу, а FFTW исполняет план без копирования.
+ */
+template<class T, size_t Alignment = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template<class U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator(void) = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T * allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof (T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T * p, size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+        return false;
+    }
+};
+
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
 // =============================================================================
 // Fast Furier Transform impl
 // =============================================================================
@@ -28,37 +105,153 @@ static unsigned int bitReverse(unsigned int x, int log2n) {
 }
 
 /**
- * @brief Функция расчёта FFT для вектора комплексных чисел
- * @param a Начальный итератор вектора комплексных отсчётов сигнала
+ * @brief Приведение отсчёта сигнала к комплексному типу FFT
+ *
+ * Используется на этапе бит-реверсивной загрузки stdComplexFFT, так что
+ * отсчёты любого поддерживаемого формата преобразуются во float без
+ * отдельного прохода по памяти. Перегрузка выбирается при компиляции.
+ */
+template<class Complex_T>
+inline Complex_T toComplex(const iq16_t & sample) {
+    return Complex_T(sample.I, sample.Q);
+}
+
+template<class Complex_T>
+inline Complex_T toComplex(const iq8_t & sample) {
+    return Complex_T(sample.I, sample.Q);
+}
+
+template<class Complex_T>
+inline Complex_T toComplex(const iqu8_t & sample) {
+    return Complex_T(sample.I - 127.5f, sample.Q - 127.5f);
+}
+
+template<class Complex_T>
+inline Complex_T toComplex(const iq16be_t & sample) {
+    return Complex_T(swap16(sample.I), swap16(sample.Q));
+}
+
+template<class Complex_T>
+inline Complex_T toComplex(const r16pair_t & sample) {
+    return Complex_T(sample.even, sample.odd);
+}
+
+template<class Complex_T, class T>
+inline Complex_T toComplex(const std::complex<T> & sample) {
+    return Complex_T(sample.real(), sample.imag());
+}
+
+/**
+ * @brief План FFT размера 2^log2n
+ *
+ * Содержит таблицу бит-реверсивной перестановки и точные (вычисленные в
+ * double) поворачивающие множители всех ступеней, уложенные подряд:
+ * множители ступени с полуразмером m2 занимают элементы [m2 - 1, 2 * m2 - 1).
+ * План строится один раз на размер и используется всеми рабочими потоками
+ * только на чтение, поэтому во внутренних циклах остаются одни бабочки.
+ */
+template<class Complex_T>
+class FFTPlan {
+protected:
+    int order;
+    std::vector<uint32_t> permutation;
+    std::vector<Complex_T> twiddles;
+
+public:
+    explicit FFTPlan(int log2n) : order(log2n) {
+        const uint32_t n = pow2(log2n);
+        this->permutation.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            this->permutation[i] = bitReverse(i, log2n);
+        }
+        this->twiddles.resize(n > 1 ? n - 1 : 0);
+        for (uint32_t m2 = 1; m2 < n; m2 <<= 1) {
+            for (uint32_t j = 0; j < m2; j++) {
+                std::complex<double> w = std::polar(1.0, -M_PI * (double)j / (double)m2);
+                this->twiddles[m2 - 1 + j] = Complex_T(w.real(), w.imag());
+            }
+        }
+    }
+
+    /**
+     * @brief Общий план для размера 2^log2n, строится при первом запросе
+     */
+    static const FFTPlan & get(int log2n) {
+        static std::once_flag built[32];
+        static std::unique_ptr<FFTPlan> plans[32];
+        std::call_once(built[log2n], [log2n]() {
+            plans[log2n].reset(new FFTPlan(log2n));
+        });
+        return *plans[log2n];
+    }
+
+    int log2n(void) const {
+        return this->order;
+    }
+
+    uint32_t size(void) const {
+        return pow2(this->order);
+    }
+
+    const uint32_t * reverse(void) const {
+        return this->permutation.data();
+    }
+
+    const Complex_T * stageTwiddles(uint32_t m2) const {
+        return this->twiddles.data() + m2 - 1;
+    }
+};
+
+/**
+ * @brief Функция расчёта FFT для вектора комплексных чисел по готовому плану
+ * @param a Начальный итератор отсчётов сигнала (комплексных либо целочисленных iq)
  * @param b Начальный итератор вектора результата вычисления комплексного FFT
- * @param log2n 2^log2n порядок FFT
+ * @param plan План FFT требуемого размера
  */
-template<class Iter_T>
-void stdComplexFFT(Iter_T a, Iter_T b, int log2n)
+template<class InIter_T, class OutIter_T>
+void stdComplexFFT(InIter_T a, OutIter_T b, \
+                   const FFTPlan<typename std::iterator_traits<OutIter_T>::value_type> & plan)
 {
-    typedef typename std::iterator_traits<Iter_T>::value_type complex;
-    const complex J(0, 1);
-    int n = 1 << log2n;
-    for (unsigned int i=0; i < n; ++i) {
-        b[bitReverse(i, log2n)] = a[i];
+    typedef typename std::iterator_traits<OutIter_T>::value_type complex;
+    typedef typename complex::value_type real;
+    const uint32_t n = plan.size();
+    const uint32_t * reverse = plan.reverse();
+    for (uint32_t i = 0; i < n; ++i) {
+        b[reverse[i]] = toComplex<complex>(a[i]);
     }
-    for (int s = 1; s <= log2n; ++s) {
-        int m = 1 << s;
-        int m2 = m >> 1;
-        complex w(1, 0);
-        complex wm = exp(-J * ((float)M_PI / m2));
-        for (int j=0; j < m2; ++j) {
-            for (int k=j; k < n; k += m) {
-                complex t = w * b[k + m2];
-                complex u = b[k];
-                b[k] = u + t;
-                b[k + m2] = u - t;
+    for (uint32_t m2 = 1; m2 < n; m2 <<= 1) {
+        const uint32_t m = m2 << 1;
+        const complex * w = plan.stageTwiddles(m2);
+        for (uint32_t k = 0; k < n; k += m) {
+            for (uint32_t j = 0; j < m2; ++j) {
+                // Component-wise butterfly: operator* goes through the
+                // NaN-checking libcall and packed temporaries stall on stores
+                const real xr = b[k + j + m2].real();
+                const real xi = b[k + j + m2].imag();
+                const real tr = w[j].real() * xr - w[j].imag() * xi;
+                const real ti = w[j].real() * xi + w[j].imag() * xr;
+                const real ur = b[k + j].real();
+                const real ui = b[k + j].imag();
+                b[k + j] = complex(ur + tr, ui + ti);
+                b[k + j + m2] = complex(ur - tr, ui - ti);
             }
-            w *= wm;
         }
     }
 }
 
+/**
+ * @brief Функция расчёта FFT для вектора комплексных чисел
+ * @param a Начальный итератор отсчётов сигнала (комплексных либо целочисленных iq)
+ * @param b Начальный итератор вектора результата вычисления комплексного FFT
+ * @param log2n 2^log2n порядок FFT
+ */
+template<class InIter_T, class OutIter_T>
+void stdComplexFFT(InIter_T a, OutIter_T b, int log2n)
+{
+    typedef typename std::iterator_traits<OutIter_T>::value_type complex;
+    stdComplexFFT(a, b, FFTPlan<complex>::get(log2n));
+}
+
 // =============================================================================
 
 #endif // DSP_HPP
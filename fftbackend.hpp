@@ -0,0 +1,262 @@
+#ifndef FFTBACKEND_HPP
+#define FFTBACKEND_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+#include "fftkernel.hpp"
+
+#ifdef WATERFALL_WITH_FFTW
+#include <fftw3.h>
+#endif
+
+#ifdef WATERFALL_WITH_POCKETFFT
+#include <pocketfft_hdronly.h>
+#endif
+
+// =============================================================================
+// Pluggable FFT backends
+// =============================================================================
+//
+// Built-in kernels (fftkernel.hpp) stay the default, without a backend
+// object, and keep their fused sample conversion and row batching. External
+// libraries are compiled in by the WATERFALL_WITH_FFTW and
+// WATERFALL_WITH_POCKETFFT CMake options and are chosen at runtime by name,
+// so one build can A/B them on the same record. Every backend builds its
+// plan once per size, from the interface thread, and the workers get the
+// ready plan object with the pass parameters: rows never look plans up and
+// never take a lock. Both libraries take any size natively, powers of two
+// as well as mixed-radix and prime sizes.
+
+/**
+ * @brief Готовый план внешнего FFT одного размера, общий для рабочих потоков
+ */
+class FFTBackendPlan {
+public:
+    virtual ~FFTBackendPlan() {}
+
+    virtual size_t size(void) const = 0;
+
+    /**
+     * @brief Прямое FFT размера size()
+     * @param in Отсчёты, буфер может быть использован как рабочий
+     * @param out Результат, не пересекается с in
+     */
+    virtual void transform(std::complex<float> * in, std::complex<float> * out) const = 0;
+};
+
+/**
+ * @brief Внешняя реализация прямого комплексного FFT произвольного размера
+ */
+class FFTBackend {
+public:
+    virtual ~FFTBackend() {}
+
+    virtual const char * name(void) const = 0;
+
+    /**
+     * @brief План размера n
+     *
+     * Вызывается из потока интерфейса до запуска рабочих потоков, чтобы
+     * долгое планирование не попадало в обработку. Повторный вызов для
+     * того же размера возвращает построенный план; планы живут вместе
+     * с бэкендом.
+     */
+    virtual const FFTBackendPlan * prepare(size_t n) = 0;
+};
+
+#ifdef WATERFALL_WITH_FFTW
+/**
+ * @brief План FFTW3 одного размера
+ *
+ * Исполнение готового плана потокобезопасно. Буферы рабочих потоков
+ * выровнены (AlignedVector), и строки идут напрямую через
+ * fftwf_execute_dft; для прочих буферов копия идёт через рабочие
+ * массивы потока, выделенные один раз.
+ */
+class FFTBackendPlan_FFTW : public FFTBackendPlan {
+protected:
+    size_t length;
+    fftwf_plan handle;
+
+public:
+    FFTBackendPlan_FFTW(size_t n) : length(n) {
+        fftwf_complex * in = fftwf_alloc_complex(n);
+        fftwf_complex * out = fftwf_alloc_complex(n);
+        this->handle = fftwf_plan_dft_1d(n, in, out, FFTW_FORWARD, FFTW_MEASURE);
+        fftwf_free(in);
+        fftwf_free(out);
+    }
+
+    ~FFTBackendPlan_FFTW() {
+        if (this->handle != nullptr) {
+            fftwf_destroy_plan(this->handle);
+        }
+    }
+
+    size_t size(void) const override {
+        return this->length;
+    }
+
+    void transform(std::complex<float> * in, std::complex<float> * out) const override {
+        const size_t n = this->length;
+        float * src = reinterpret_cast<float *>(in);
+        float * dst = reinterpret_cast<float *>(out);
+        // New-array execution requires the alignment the plan was built for
+        if (fftwf_alignment_of(src) == 0 && fftwf_alignment_of(dst) == 0) {
+            fftwf_execute_dft(this->handle, reinterpret_cast<fftwf_complex *>(src), reinterpret_cast<fftwf_complex *>(dst));
+            return;
+        }
+        thread_local std::unique_ptr<fftwf_complex, void (*)(void *)> scratch(nullptr, fftwf_free);
+        thread_local size_t scratchSize = 0;
+        if (scratchSize < n) {
+            scratch.reset(fftwf_alloc_complex(2 * n));
+            scratchSize = n;
+        }
+        fftwf_complex * alignedIn = scratch.get();
+        fftwf_complex * alignedOut = scratch.get() + n;
+        std::copy(in, in + n, reinterpret_cast<std::complex<float> *>(alignedIn));
+        fftwf_execute_dft(this->handle, alignedIn, alignedOut);
+        std::copy_n(reinterpret_cast<const std::complex<float> *>(alignedOut), n, out);
+    }
+};
+
+/**
+ * @brief FFTW3 (одинарная точность)
+ *
+ * Планы строятся с FFTW_MEASURE; накопленная мудрость (wisdom) читается
+ * из файла при создании и дописывается после каждого нового плана, так
+ * что измерение для размера выполняется один раз на машину.
+ */
+class FFTBackend_FFTW : public FFTBackend {
+protected:
+    std::string wisdomFile;
+    // The planner is not thread-safe, plans are built under the lock
+    std::mutex plannerMutex;
+    std::map<size_t, std::unique_ptr<FFTBackendPlan_FFTW>> plans;
+
+public:
+    explicit FFTBackend_FFTW(const std::string & wisdom) : wisdomFile(wisdom) {
+        if (!this->wisdomFile.empty()) {
+            fftwf_import_wisdom_from_filename(this->wisdomFile.c_str());
+        }
+    }
+
+    const char * name(void) const override {
+        return "fftw";
+    }
+
+    const FFTBackendPlan * prepare(size_t n) override {
+        std::lock_guard<std::mutex> lock(this->plannerMutex);
+        std::unique_ptr<FFTBackendPlan_FFTW> & item = this->plans[n];
+        if (!item) {
+            item.reset(new FFTBackendPlan_FFTW(n));
+            if (!this->wisdomFile.empty()) {
+                fftwf_export_wisdom_to_filename(this->wisdomFile.c_str());
+            }
+        }
+        return item.get();
+    }
+};
+#endif // WATERFALL_WITH_FFTW
+
+#ifdef WATERFALL_WITH_POCKETFFT
+/**
+ * @brief План pocketfft одного размера
+ */
+class FFTBackendPlan_PocketFFT : public FFTBackendPlan {
+protected:
+    size_t length;
+    pocketfft::detail::pocketfft_c<float> handle;
+
+public:
+    FFTBackendPlan_PocketFFT(size_t n) : length(n), handle(n) {}
+
+    size_t size(void) const override {
+        return this->length;
+    }
+
+    void transform(std::complex<float> * in, std::complex<float> * out) const override {
+        // Plans run in place and allocate their scratch per call
+        std::copy(in, in + this->length, out);
+        this->handle.exec(reinterpret_cast<pocketfft::detail::cmplx<float> *>(out), 1.0f, true);
+    }
+};
+
+/**
+ * @brief pocketfft (заголовочная версия из 3rdparty/pocketfft)
+ */
+class FFTBackend_PocketFFT : public FFTBackend {
+protected:
+    std::mutex plansMutex;
+    std::map<size_t, std::unique_ptr<FFTBackendPlan_PocketFFT>> plans;
+
+public:
+    const char * name(void) const override {
+        return "pocketfft";
+    }
+
+    const FFTBackendPlan * prepare(size_t n) override {
+        std::lock_guard<std::mutex> lock(this->plansMutex);
+        std::unique_ptr<FFTBackendPlan_PocketFFT> & item = this->plans[n];
+        if (!item) {
+            item.reset(new FFTBackendPlan_PocketFFT(n));
+        }
+        return item.get();
+    }
+};
+#endif // WATERFALL_WITH_POCKETFFT
+
+/**
+ * @brief Имена бэкендов, включённых в сборку
+ */
+inline std::vector<std::string> fftBackendNames(void)
+{
+    std::vector<std::string> names{"builtin"};
+#ifdef WATERFALL_WITH_FFTW
+    names.push_back("fftw");
+#endif
+#ifdef WATERFALL_WITH_POCKETFFT
+    names.push_back("pocketfft");
+#endif
+    return names;
+}
+
+/**
+ * @brief Поиск бэкенда по имени
+ *
+ * Каждый бэкенд создаётся один раз и живёт до завершения программы,
+ * вместе с построенными планами.
+ * @param name Имя бэкенда (fftBackendNames())
+ * @param wisdomFile Файл мудрости FFTW, учитывается при первом обращении
+ * @return nullptr для встроенных ядер либо бэкенда, не включённого в сборку
+ */
+inline FFTBackend * fftBackendFind(const std::string & name, const std::string & wisdomFile = std::string())
+{
+#ifdef WATERFALL_WITH_FFTW
+    if (name == "fftw") {
+        static FFTBackend_FFTW backend(wisdomFile);
+        return &backend;
+    }
+#endif
+#ifdef WATERFALL_WITH_POCKETFFT
+    if (name == "pocketfft") {
+        static FFTBackend_PocketFFT backend;
+        return &backend;
+    }
+#endif
+    (void)name;
+    (void)wisdomFile;
+    return nullptr;
+}
+
+// =============================================================================
+
+#endif // FFTBACKEND_HPP
@@ -0,0 +1,566 @@
+#ifndef FFTFIXED_HPP
+#define FFTFIXED_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "dsp.hpp"
+#include "fftkernel.hpp"
+
+// =============================================================================
+// Q15 block floating point FFT for int16 samples
+// =============================================================================
+//
+// Quick-look engine: iq16_t rows are transformed in int16 without widening,
+// so a register holds twice as many points as with float. Twiddles are Q15,
+// products go through pmulhrsw (rounded (x w) >> 15) and sums saturate.
+//
+// The whole row shares one exponent. The load normalizes the row peak to
+// [2^12, 2^13), applies the Q15 window and runs the two first stages (unit
+// twiddles, growth 4) on the fly. The window only lowers the peak, so the
+// normalization is taken from the raw samples. Before every following
+// stage the data is halved, with rounding, once or twice while the peak is
+// 2^13 or more: a radix-2 butterfly grows a component at most 1 + sqrt(2)
+// times, so stage inputs below 2^13 never reach the saturation bound. The
+// spectrum is out * 2^exponent with 13-14 significant bits, about 70 dB of
+// dynamic range below the row peak.
+
+static constexpr int fftFixedMinOrder = 4;
+static constexpr int32_t fftFixedLimit = 1 << 13;
+
+/**
+ * @brief Q15-множители для всех ступеней размера 2^log2n
+ *
+ * Множитель j ступени m2 хранится парами под чередующиеся {re, im}:
+ * {wr, wr} в stageRe(m2) и {-wi, wi} в stageIm(m2), так что произведение
+ * x w = x stageRe + swap(x) stageIm.
+ */
+class FFTFixedPlan {
+protected:
+    const fftPlan_t & floatPlan;
+    std::vector<int16_t> twiddlesRe;
+    std::vector<int16_t> twiddlesIm;
+
+public:
+    explicit FFTFixedPlan(int log2n) : floatPlan(fftPlan_t::get(log2n)) {
+        const uint32_t n = this->floatPlan.size();
+        this->twiddlesRe.resize(n > 1 ? 2 * (n - 1) : 0);
+        this->twiddlesIm.resize(n > 1 ? 2 * (n - 1) : 0);
+        for (uint32_t m2 = 1; m2 < n; m2 <<= 1) {
+            const std::complex<float> * w = this->floatPlan.stageTwiddles(m2);
+            for (uint32_t j = 0; j < m2; j++) {
+                const int16_t wr = (int16_t)std::lround(w[j].real() * 32767.0f);
+                const int16_t wi = (int16_t)std::lround(w[j].imag() * 32767.0f);
+                const size_t index = 2 * (m2 - 1 + j);
+                this->twiddlesRe[index] = wr;
+                this->twiddlesRe[index + 1] = wr;
+                this->twiddlesIm[index] = -wi;
+                this->twiddlesIm[index + 1] = wi;
+            }
+        }
+    }
+
+    /**
+     * @brief Общий план для размера 2^log2n, строится при первом запросе
+     */
+    static const FFTFixedPlan & get(int log2n) {
+        static std::once_flag built[32];
+        static std::unique_ptr<FFTFixedPlan> plans[32];
+        std::call_once(built[log2n], [log2n]() {
+            plans[log2n].reset(new FFTFixedPlan(log2n));
+        });
+        return *plans[log2n];
+    }
+
+    const fftPlan_t & base(void) const {
+        return this->floatPlan;
+    }
+
+    uint32_t size(void) const {
+        return this->floatPlan.size();
+    }
+
+    const int16_t * stageRe(uint32_t m2) const {
+        return this->twiddlesRe.data() + 2 * (m2 - 1);
+    }
+
+    const int16_t * stageIm(uint32_t m2) const {
+        return this->twiddlesIm.data() + 2 * (m2 - 1);
+    }
+};
+
+inline int16_t fftFixedSaturate(int32_t value)
+{
+    return (int16_t)std::min<int32_t>(std::max<int32_t>(value, -32768), 32767);
+}
+
+/**
+ * @brief Нормировка пика строки в [2^12, 2^13)
+ *
+ * Слабые строки умножаются на 2^up, сильные делятся на 2^down с
+ * округлением (разность с постоянной составляющей может занимать 17 бит);
+ * оба случая - одно произведение (x - dc) factor с постоянным сдвигом 15.
+ * @param maxAbs Наибольший модуль компоненты x - dc, больше нуля
+ * @param factor Множитель 2^(15 + up - down)
+ * @return Показатель нормировки down - up
+ */
+inline int fftFixedNormalize(int32_t maxAbs, int32_t & factor)
+{
+    int up = 0, down = 0;
+    while ((maxAbs << (up + 1)) < fftFixedLimit) {
+        up++;
+    }
+    while (((maxAbs + ((1 << down) >> 1)) >> down) >= fftFixedLimit) {
+        down++;
+    }
+    factor = 1 << (15 + up - down);
+    return down - up;
+}
+
+/**
+ * @brief Сигнатура загрузки строки: бит-реверсивный порядок, вычитание
+ * постоянной составляющей, нормировка и две первые ступени
+ * @param a Отсчёты строки
+ * @param d Результат, 2 n значений int16 {re, im}
+ * @param plan План FFT
+ * @param dc Постоянная составляющая
+ * @param window Q15-окно в бит-реверсивном порядке (FFTWindow::fixedValues()),
+ * применяется после нормировки; nullptr - без окна
+ * @param peak Наибольший модуль компоненты результата
+ * @return Показатель нормировки: d = (a - dc) w * 2^-exponent
+ */
+typedef int (*fftFixedLoadFunc_t)(const iq16_t * a, int16_t * d, const fftPlan_t & plan, \
+                                  std::complex<float> dc, const int16_t * window, int32_t & peak);
+
+/**
+ * @brief Сигнатура ступени radix-2 с m2 >= 4
+ * @param d Данные {re, im}, результат на месте
+ * @param shift Деление входа на 2^shift с округлением перед ступенью
+ * @return Наибольший модуль компоненты результата
+ */
+typedef int32_t (*fftFixedStageFunc_t)(int16_t * d, uint32_t n, uint32_t m2, \
+                                       const int16_t * wre, const int16_t * wim, int shift);
+
+inline int fftFixedLoadScalar(const iq16_t * a, int16_t * d, const fftPlan_t & plan, \
+                              std::complex<float> dc, const int16_t * window, int32_t & peak)
+{
+    const uint32_t n = plan.size();
+    const int32_t dcI = (int32_t)std::lround(dc.real());
+    const int32_t dcQ = (int32_t)std::lround(dc.imag());
+
+    int16_t minI = a[0].I, maxI = a[0].I, minQ = a[0].Q, maxQ = a[0].Q;
+    for (uint32_t i = 1; i < n; i++) {
+        minI = std::min(minI, a[i].I);
+        maxI = std::max(maxI, a[i].I);
+        minQ = std::min(minQ, a[i].Q);
+        maxQ = std::max(maxQ, a[i].Q);
+    }
+    const int32_t maxAbs = std::max(std::max(maxI - dcI, dcI - minI), std::max(maxQ - dcQ, dcQ - minQ));
+    peak = 0;
+    if (maxAbs <= 0) {
+        std::fill(d, d + 2 * n, 0);
+        return 0;
+    }
+    int32_t factor;
+    const int exponent = fftFixedNormalize(maxAbs, factor);
+
+    // Same pass as fftRadix4First, exact in int32; inputs below 2^13 grow
+    // at most 4 times and fit int16 without saturation
+    const uint32_t * reverse = plan.reverse();
+    for (uint32_t k = 0; k < n; k += 4) {
+        int32_t x[8];
+        for (uint32_t i = 0; i < 4; i++) {
+            const iq16_t sample = a[reverse[k + i]];
+            x[2 * i] = ((sample.I - dcI) * factor + (1 << 14)) >> 15;
+            x[2 * i + 1] = ((sample.Q - dcQ) * factor + (1 << 14)) >> 15;
+            if (window != nullptr) {
+                // Rounded Q15 product, as pmulhrsw
+                x[2 * i] = (x[2 * i] * window[2 * (k + i)] + (1 << 14)) >> 15;
+                x[2 * i + 1] = (x[2 * i + 1] * window[2 * (k + i) + 1] + (1 << 14)) >> 15;
+            }
+        }
+        const int32_t a0r = x[0] + x[2], a0i = x[1] + x[3];
+        const int32_t a1r = x[0] - x[2], a1i = x[1] - x[3];
+        const int32_t a2r = x[4] + x[6], a2i = x[5] + x[7];
+        const int32_t a3r = x[4] - x[6], a3i = x[5] - x[7];
+        const int32_t y[8] = {a0r + a2r, a0i + a2i, a1r + a3i, a1i - a3r, \
+                              a0r - a2r, a0i - a2i, a1r - a3i, a1i + a3r};
+        int16_t * p = d + 2 * k;
+        for (uint32_t i = 0; i < 8; i++) {
+            p[i] = (int16_t)y[i];
+            peak = std::max(peak, std::abs(y[i]));
+        }
+    }
+    return exponent;
+}
+
+inline int32_t fftFixedStageScalar(int16_t * d, uint32_t n, uint32_t m2, \
+                                   const int16_t * wre, const int16_t * wim, int shift)
+{
+    const int32_t round = (1 << shift) >> 1;
+    int32_t peak = 0;
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j++) {
+            int16_t * p0 = d + 2 * (k + j);
+            int16_t * p1 = p0 + 2 * m2;
+            const int32_t ar = (p0[0] + round) >> shift, ai = (p0[1] + round) >> shift;
+            const int32_t br = (p1[0] + round) >> shift, bi = (p1[1] + round) >> shift;
+            const int32_t wr = wre[2 * j], wi = wim[2 * j + 1];
+            const int32_t tr = (br * wr - bi * wi + (1 << 14)) >> 15;
+            const int32_t ti = (bi * wr + br * wi + (1 << 14)) >> 15;
+            const int32_t y[4] = {ar + tr, ai + ti, ar - tr, ai - ti};
+            p0[0] = fftFixedSaturate(y[0]);
+            p0[1] = fftFixedSaturate(y[1]);
+            p1[0] = fftFixedSaturate(y[2]);
+            p1[1] = fftFixedSaturate(y[3]);
+            for (int32_t v : y) {
+                peak = std::max(peak, std::abs(v));
+            }
+        }
+    }
+    return std::min<int32_t>(peak, 32768);
+}
+
+#ifdef IQCONVERT_X86
+// pmulhrsw needs SSSE3 and the peak reduction uses phminposuw, so the
+// 128-bit path starts at the SSE4.1 level. |x| is tracked as unsigned:
+// abs(-32768) stays 0x8000 and compares as the largest value.
+//
+// Vector loads split the scalar pass: the range is reduced over the
+// contiguous row, the bit-reversed gather is a plain copy of 32-bit pairs,
+// and normalization with the two first stages runs on whole registers.
+
+__attribute__((target("sse4.1")))
+inline int32_t fftFixedPeakSSE41(__m128i peak)
+{
+    // Maximum of unsigned lanes is the minimum of their complements
+    const __m128i minimum = _mm_minpos_epu16(_mm_xor_si128(peak, _mm_set1_epi16(-1)));
+    return 0xFFFF - (_mm_cvtsi128_si32(minimum) & 0xFFFF);
+}
+
+/**
+ * @brief Наибольший модуль x - dc по минимумам и максимумам 8 дорожек
+ * (чётные - I, нечётные - Q)
+ */
+inline int32_t fftFixedRangeAbs(const int16_t * mins, const int16_t * maxs, int32_t dcI, int32_t dcQ)
+{
+    int32_t maxAbs = 0;
+    for (int l = 0; l < 8; l++) {
+        const int32_t c = (l & 1) ? dcQ : dcI;
+        maxAbs = std::max(maxAbs, std::max(maxs[l] - c, c - mins[l]));
+    }
+    return maxAbs;
+}
+
+inline void fftFixedGather(const iq16_t * a, int16_t * d, const fftPlan_t & plan)
+{
+    iq16_t * b = reinterpret_cast<iq16_t *>(d);
+    const uint32_t n = plan.size();
+    const uint32_t * reverse = plan.reverse();
+    // Reversal is an involution: reads are scattered, stores stay sequential
+    for (uint32_t i = 0; i < n; i++) {
+        b[i] = a[reverse[i]];
+    }
+}
+
+/**
+ * @brief Две первые ступени для 4 точек каждой 128-битной дорожки
+ *
+ * {c0, c1, c2, c3} -> a = {c0 + c1, c0 - c1, c2 + c3, c2 - c3}, затем
+ * {a0 + a2, a1 - j a3, a0 - a2, a1 + j a3}, как в fftRadix4First.
+ */
+__attribute__((target("sse4.1")))
+inline __m128i fftFixedFirstSSE41(__m128i x)
+{
+    const __m128i swap = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i negIm = _mm_setr_epi16(1, -1, 1, -1, 1, -1, 1, -1);
+    const __m128i y = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128i a = _mm_blend_epi16(_mm_add_epi16(x, y), _mm_sub_epi16(y, x), 0xCC);
+    // -j a3 = {a3i, -a3r}
+    a = _mm_blend_epi16(a, _mm_sign_epi16(_mm_shuffle_epi8(a, swap), negIm), 0xC0);
+    const __m128i b = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_blend_epi16(_mm_add_epi16(a, b), _mm_sub_epi16(b, a), 0xF0);
+}
+
+__attribute__((target("sse4.1")))
+inline int fftFixedLoadSSE41(const iq16_t * a, int16_t * d, const fftPlan_t & plan, \
+                             std::complex<float> dc, const int16_t * window, int32_t & peak)
+{
+    const uint32_t n = plan.size();
+    const int16_t * src = reinterpret_cast<const int16_t *>(a);
+    const int32_t dcI = (int32_t)std::lround(dc.real());
+    const int32_t dcQ = (int32_t)std::lround(dc.imag());
+
+    __m128i lo = _mm_set1_epi16(32767);
+    __m128i hi = _mm_set1_epi16(-32768);
+    for (uint32_t i = 0; i < 2 * n; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        lo = _mm_min_epi16(lo, x);
+        hi = _mm_max_epi16(hi, x);
+    }
+    alignas(16) int16_t mins[8];
+    alignas(16) int16_t maxs[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(mins), lo);
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxs), hi);
+    const int32_t maxAbs = fftFixedRangeAbs(mins, maxs, dcI, dcQ);
+    peak = 0;
+    if (maxAbs <= 0) {
+        std::fill(d, d + 2 * n, 0);
+        return 0;
+    }
+    int32_t factor;
+    const int exponent = fftFixedNormalize(maxAbs, factor);
+
+    fftFixedGather(a, d, plan);
+
+    const __m128i vdc = _mm_setr_epi32(dcI, dcQ, dcI, dcQ);
+    const __m128i vfactor = _mm_set1_epi32(factor);
+    const __m128i vround = _mm_set1_epi32(1 << 14);
+    __m128i vpeak = _mm_setzero_si128();
+    for (uint32_t i = 0; i < 2 * n; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(d + i));
+        __m128i x0 = _mm_cvtepi16_epi32(x);
+        __m128i x1 = _mm_cvtepi16_epi32(_mm_srli_si128(x, 8));
+        x0 = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(x0, vdc), vfactor), vround), 15);
+        x1 = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(x1, vdc), vfactor), vround), 15);
+        __m128i v = _mm_packs_epi32(x0, x1);
+        if (window != nullptr) {
+            v = _mm_mulhrs_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i *>(window + i)));
+        }
+        const __m128i y = fftFixedFirstSSE41(v);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), y);
+        vpeak = _mm_max_epu16(vpeak, _mm_abs_epi16(y));
+    }
+    peak = fftFixedPeakSSE41(vpeak);
+    return exponent;
+}
+
+template<bool Scale>
+__attribute__((target("sse4.1")))
+inline int32_t fftFixedStageSSE41Run(int16_t * d, uint32_t n, uint32_t m2, \
+                                     const int16_t * wre, const int16_t * wim, __m128i scale)
+{
+    const __m128i swap = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    __m128i peak = _mm_setzero_si128();
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j += 4) {
+            int16_t * p0 = d + 2 * (k + j);
+            int16_t * p1 = p0 + 2 * m2;
+            __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p0));
+            __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1));
+            if (Scale) {
+                x0 = _mm_mulhrs_epi16(x0, scale);
+                x1 = _mm_mulhrs_epi16(x1, scale);
+            }
+            const __m128i vwr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(wre + 2 * j));
+            const __m128i vwi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(wim + 2 * j));
+            const __m128i t = _mm_adds_epi16(_mm_mulhrs_epi16(x1, vwr), \
+                                             _mm_mulhrs_epi16(_mm_shuffle_epi8(x1, swap), vwi));
+            const __m128i y0 = _mm_adds_epi16(x0, t);
+            const __m128i y1 = _mm_subs_epi16(x0, t);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p0), y0);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p1), y1);
+            peak = _mm_max_epu16(peak, _mm_max_epu16(_mm_abs_epi16(y0), _mm_abs_epi16(y1)));
+        }
+    }
+    return fftFixedPeakSSE41(peak);
+}
+
+__attribute__((target("sse4.1")))
+inline int32_t fftFixedStageSSE41(int16_t * d, uint32_t n, uint32_t m2, \
+                                  const int16_t * wre, const int16_t * wim, int shift)
+{
+    if (shift == 0) {
+        return fftFixedStageSSE41Run<false>(d, n, m2, wre, wim, _mm_setzero_si128());
+    }
+    // mulhrs by 2^(15 - shift) is the rounded division by 2^shift
+    return fftFixedStageSSE41Run<true>(d, n, m2, wre, wim, _mm_set1_epi16((int16_t)(1 << (15 - shift))));
+}
+
+__attribute__((target("avx2")))
+inline int fftFixedLoadAVX2(const iq16_t * a, int16_t * d, const fftPlan_t & plan, \
+                            std::complex<float> dc, const int16_t * window, int32_t & peak)
+{
+    const uint32_t n = plan.size();
+    const int16_t * src = reinterpret_cast<const int16_t *>(a);
+    const int32_t dcI = (int32_t)std::lround(dc.real());
+    const int32_t dcQ = (int32_t)std::lround(dc.imag());
+
+    __m256i lo = _mm256_set1_epi16(32767);
+    __m256i hi = _mm256_set1_epi16(-32768);
+    for (uint32_t i = 0; i < 2 * n; i += 16) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        lo = _mm256_min_epi16(lo, x);
+        hi = _mm256_max_epi16(hi, x);
+    }
+    alignas(16) int16_t mins[8];
+    alignas(16) int16_t maxs[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(mins), \
+                    _mm_min_epi16(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxs), \
+                    _mm_max_epi16(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+    const int32_t maxAbs = fftFixedRangeAbs(mins, maxs, dcI, dcQ);
+    peak = 0;
+    if (maxAbs <= 0) {
+        std::fill(d, d + 2 * n, 0);
+        return 0;
+    }
+    int32_t factor;
+    const int exponent = fftFixedNormalize(maxAbs, factor);
+
+    fftFixedGather(a, d, plan);
+
+    const __m256i swap = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, \
+                                          2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i negIm = _mm256_setr_epi16(1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1);
+    const __m256i vdc = _mm256_setr_epi32(dcI, dcQ, dcI, dcQ, dcI, dcQ, dcI, dcQ);
+    const __m256i vfactor = _mm256_set1_epi32(factor);
+    const __m256i vround = _mm256_set1_epi32(1 << 14);
+    __m256i vpeak = _mm256_setzero_si256();
+    for (uint32_t i = 0; i < 2 * n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(d + i));
+        const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i *>(d + i + 8));
+        __m256i x0 = _mm256_cvtepi16_epi32(x);
+        __m256i x1 = _mm256_cvtepi16_epi32(z);
+        x0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(x0, vdc), vfactor), vround), 15);
+        x1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(x1, vdc), vfactor), vround), 15);
+        // packs works per 128-bit lane, the permute restores the point order
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(x0, x1), 0xD8);
+        if (window != nullptr) {
+            v = _mm256_mulhrs_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(window + i)));
+        }
+
+        // Two first stages inside every group of 4 points, as in fftFixedFirstSSE41
+        const __m256i y = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m256i u = _mm256_blend_epi16(_mm256_add_epi16(v, y), _mm256_sub_epi16(y, v), 0xCC);
+        u = _mm256_blend_epi16(u, _mm256_sign_epi16(_mm256_shuffle_epi8(u, swap), negIm), 0xC0);
+        const __m256i b = _mm256_shuffle_epi32(u, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m256i r = _mm256_blend_epi16(_mm256_add_epi16(u, b), _mm256_sub_epi16(b, u), 0xF0);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i), r);
+        vpeak = _mm256_max_epu16(vpeak, _mm256_abs_epi16(r));
+    }
+    peak = fftFixedPeakSSE41(_mm_max_epu16(_mm256_castsi256_si128(vpeak), _mm256_extracti128_si256(vpeak, 1)));
+    return exponent;
+}
+
+template<bool Scale>
+__attribute__((target("avx2")))
+inline int32_t fftFixedStageAVX2Run(int16_t * d, uint32_t n, uint32_t m2, \
+                                    const int16_t * wre, const int16_t * wim, __m256i scale)
+{
+    const __m256i swap = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, \
+                                          2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    __m256i peak = _mm256_setzero_si256();
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j += 8) {
+            int16_t * p0 = d + 2 * (k + j);
+            int16_t * p1 = p0 + 2 * m2;
+            __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p0));
+            __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p1));
+            if (Scale) {
+                x0 = _mm256_mulhrs_epi16(x0, scale);
+                x1 = _mm256_mulhrs_epi16(x1, scale);
+            }
+            const __m256i vwr = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(wre + 2 * j));
+            const __m256i vwi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(wim + 2 * j));
+            const __m256i t = _mm256_adds_epi16(_mm256_mulhrs_epi16(x1, vwr), \
+                                                _mm256_mulhrs_epi16(_mm256_shuffle_epi8(x1, swap), vwi));
+            const __m256i y0 = _mm256_adds_epi16(x0, t);
+            const __m256i y1 = _mm256_subs_epi16(x0, t);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(p0), y0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(p1), y1);
+            peak = _mm256_max_epu16(peak, _mm256_max_epu16(_mm256_abs_epi16(y0), _mm256_abs_epi16(y1)));
+        }
+    }
+    return fftFixedPeakSSE41(_mm_max_epu16(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1)));
+}
+
+// AVX2 processors implement SSE4.1, the 4-wide stage reuses it
+__attribute__((target("avx2")))
+inline int32_t fftFixedStageAVX2(int16_t * d, uint32_t n, uint32_t m2, \
+                                 const int16_t * wre, const int16_t * wim, int shift)
+{
+    if (m2 < 8) {
+        return fftFixedStageSSE41(d, n, m2, wre, wim, shift);
+    }
+    if (shift == 0) {
+        return fftFixedStageAVX2Run<false>(d, n, m2, wre, wim, _mm256_setzero_si256());
+    }
+    return fftFixedStageAVX2Run<true>(d, n, m2, wre, wim, _mm256_set1_epi16((int16_t)(1 << (15 - shift))));
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Загрузка и ступени FFT в int16, выбранные по cpuLevel()
+ */
+struct FFTFixedKernel {
+    fftFixedLoadFunc_t load{nullptr};
+    fftFixedStageFunc_t stage{nullptr};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+/**
+ * @brief 512-битные целочисленные операции требуют AVX-512BW, поэтому
+ * на уровне AVX-512 используются ядра AVX2
+ */
+inline FFTFixedKernel fftFixedSelect(void)
+{
+    FFTFixedKernel kernel;
+    kernel.load = fftFixedLoadScalar;
+    kernel.stage = fftFixedStageScalar;
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX2) {
+        kernel.load = fftFixedLoadAVX2;
+        kernel.stage = fftFixedStageAVX2;
+        kernel.level = CpuLevel_AVX2;
+    } else if (cpuLevel() >= CpuLevel_SSE41) {
+        kernel.load = fftFixedLoadSSE41;
+        kernel.stage = fftFixedStageSSE41;
+        kernel.level = CpuLevel_SSE41;
+    }
+#endif
+    return kernel;
+}
+
+inline const FFTFixedKernel & fftFixedKernel(void)
+{
+    static const FFTFixedKernel kernel = fftFixedSelect();
+    return kernel;
+}
+
+/**
+ * @brief FFT строки iq16_t в блочной плавающей точке
+ * @param a Отсчёты строки, plan.size() >= 2^fftFixedMinOrder
+ * @param b Спектр в int16, не пересекается с a
+ * @param plan План FFT
+ * @param dc Постоянная составляющая, вычитаемая при загрузке
+ * @param window Q15-окно в бит-реверсивном порядке, nullptr - без окна
+ * @return Показатель блока: спектр равен b * 2^exponent
+ */
+inline int fastFixedFFT(const iq16_t * a, iq16_t * b, const FFTFixedPlan & plan, \
+                        std::complex<float> dc = {0, 0}, const int16_t * window = nullptr)
+{
+    const FFTFixedKernel & kernel = fftFixedKernel();
+    int16_t * d = reinterpret_cast<int16_t *>(b);
+    const uint32_t n = plan.size();
+    int32_t peak = 0;
+    int exponent = kernel.load(a, d, plan.base(), dc, window, peak);
+
+    for (uint32_t m2 = 4; m2 < n; m2 <<= 1) {
+        const int shift = peak >= 2 * fftFixedLimit ? 2 : (peak >= fftFixedLimit ? 1 : 0);
+        peak = kernel.stage(d, n, m2, plan.stageRe(m2), plan.stageIm(m2), shift);
+        exponent += shift;
+    }
+    return exponent;
+}
+
+// =============================================================================
+
+#endif // FFTFIXED_HPP
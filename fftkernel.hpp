@@ -0,0 +1,831 @@
+#ifndef FFTKERNEL_HPP
+#define FFTKERNEL_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+
+#include "dsp.hpp"
+#include "iqconvert.hpp"
+#include "sampleformat.hpp"
+
+// =============================================================================
+// Radix-2^2 butterfly kernels for complex<float> FFT
+// =============================================================================
+//
+// Input is already in bit-reversed order (see fastComplexFFT). Two radix-2
+// DIT stages with half sizes m2 and 2 * m2 are merged into one radix-4 pass:
+//
+//   a0' = a0 + w1 a1    a1' = a0 - w1 a1    w1 = W(2 m2, j)
+//   a2' = a2 + w1 a3    a3' = a2 - w1 a3    w2 = W(4 m2, j)
+//   y0 = a0' + w2 a2'   y2 = a0' - w2 a2'
+//   y1 = a1' - j w2 a3' y3 = a1' + j w2 a3'
+//
+// so every pass touches the data once for two stages and needs three complex
+// products per four points. Odd orders finish with one radix-2 pass.
+// Twiddles of both stages are taken from FFTPlan, contiguous in j.
+
+typedef FFTPlan<std::complex<float>> fftPlan_t;
+
+/**
+ * @brief Сигнатура ядра бабочек FFT
+ * @param data Отсчёты в бит-реверсивном порядке, результат на месте
+ * @param plan План FFT размера данных
+ */
+typedef void (*fftKernelFunc_t)(std::complex<float> * data, const fftPlan_t & plan);
+
+inline void fftRadix2First(float * d, uint32_t n)
+{
+    for (uint32_t k = 0; k < n; k += 2) {
+        const float ur = d[2 * k], ui = d[2 * k + 1];
+        const float vr = d[2 * k + 2], vi = d[2 * k + 3];
+        d[2 * k] = ur + vr;
+        d[2 * k + 1] = ui + vi;
+        d[2 * k + 2] = ur - vr;
+        d[2 * k + 3] = ui - vi;
+    }
+}
+
+// First radix-4 pass of even orders has unit twiddles
+inline void fftRadix4First(float * d, uint32_t n)
+{
+    for (uint32_t k = 0; k < n; k += 4) {
+        float * p = d + 2 * k;
+        const float a0r = p[0] + p[2], a0i = p[1] + p[3];
+        const float a1r = p[0] - p[2], a1i = p[1] - p[3];
+        const float a2r = p[4] + p[6], a2i = p[5] + p[7];
+        const float a3r = p[4] - p[6], a3i = p[5] - p[7];
+        p[0] = a0r + a2r;
+        p[1] = a0i + a2i;
+        p[4] = a0r - a2r;
+        p[5] = a0i - a2i;
+        p[2] = a1r + a3i;
+        p[3] = a1i - a3r;
+        p[6] = a1r - a3i;
+        p[7] = a1i + a3r;
+    }
+}
+
+inline void fftRadix4StageScalar(float * d, uint32_t n, uint32_t m2, const float * w1, const float * w2)
+{
+    for (uint32_t k = 0; k < n; k += 4 * m2) {
+        for (uint32_t j = 0; j < m2; j++) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            float * p2 = p1 + 2 * m2;
+            float * p3 = p2 + 2 * m2;
+            const float w1r = w1[2 * j], w1i = w1[2 * j + 1];
+            const float w2r = w2[2 * j], w2i = w2[2 * j + 1];
+
+            const float t1r = w1r * p1[0] - w1i * p1[1], t1i = w1r * p1[1] + w1i * p1[0];
+            const float t3r = w1r * p3[0] - w1i * p3[1], t3i = w1r * p3[1] + w1i * p3[0];
+            const float a0r = p0[0] + t1r, a0i = p0[1] + t1i;
+            const float a1r = p0[0] - t1r, a1i = p0[1] - t1i;
+            const float a2r = p2[0] + t3r, a2i = p2[1] + t3i;
+            const float a3r = p2[0] - t3r, a3i = p2[1] - t3i;
+
+            const float u2r = w2r * a2r - w2i * a2i, u2i = w2r * a2i + w2i * a2r;
+            // w2 * a3' * (-j)
+            const float u3r = w2r * a3i + w2i * a3r, u3i = -(w2r * a3r - w2i * a3i);
+
+            p0[0] = a0r + u2r;
+            p0[1] = a0i + u2i;
+            p2[0] = a0r - u2r;
+            p2[1] = a0i - u2i;
+            p1[0] = a1r + u3r;
+            p1[1] = a1i + u3i;
+            p3[0] = a1r - u3r;
+            p3[1] = a1i - u3i;
+        }
+    }
+}
+
+inline void fftRadix2StageScalar(float * d, uint32_t n, uint32_t m2, const float * w)
+{
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j++) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            const float wr = w[2 * j], wi = w[2 * j + 1];
+            const float tr = wr * p1[0] - wi * p1[1], ti = wr * p1[1] + wi * p1[0];
+            const float ur = p0[0], ui = p0[1];
+            p0[0] = ur + tr;
+            p0[1] = ui + ti;
+            p1[0] = ur - tr;
+            p1[1] = ui - ti;
+        }
+    }
+}
+
+typedef void (*fftStage4Func_t)(float * d, uint32_t n, uint32_t m2, const float * w1, const float * w2);
+typedef void (*fftStage2Func_t)(float * d, uint32_t n, uint32_t m2, const float * w);
+
+/**
+ * @brief Порядок ступеней: первая пара ступеней с единичными множителями,
+ * затем проходы radix-4 и, для нечётного порядка, завершающий проход radix-2
+ *
+ * Все нетривиальные проходы начинаются с m2 = 4, поэтому векторные ядра
+ * всегда обрабатывают целые регистры.
+ */
+inline void fftRadix4Run(std::complex<float> * data, const fftPlan_t & plan, \
+                         fftStage4Func_t stage4, fftStage2Func_t stage2)
+{
+    float * d = reinterpret_cast<float *>(data);
+    const uint32_t n = plan.size();
+    if (n < 4) {
+        if (n == 2) {
+            fftRadix2First(d, n);
+        }
+        return;
+    }
+
+    fftRadix4First(d, n);
+    uint32_t m2 = 4;
+    for (; 4 * m2 <= n; m2 <<= 2) {
+        stage4(d, n, m2, reinterpret_cast<const float *>(plan.stageTwiddles(m2)), \
+               reinterpret_cast<const float *>(plan.stageTwiddles(2 * m2)));
+    }
+    if (m2 < n) {
+        stage2(d, n, m2, reinterpret_cast<const float *>(plan.stageTwiddles(m2)));
+    }
+}
+
+inline void fftRadix4Scalar(std::complex<float> * data, const fftPlan_t & plan)
+{
+    fftRadix4Run(data, plan, fftRadix4StageScalar, fftRadix2StageScalar);
+}
+
+#ifdef IQCONVERT_X86
+// SSE4.1 machines: two complex numbers per register, the product is built
+// from addsub since there is no FMA
+
+__attribute__((target("sse4.1")))
+inline __m128 fftMulSSE41(__m128 a, __m128 w)
+{
+    const __m128 wr = _mm_moveldup_ps(w);
+    const __m128 wi = _mm_movehdup_ps(w);
+    return _mm_addsub_ps(_mm_mul_ps(a, wr), _mm_mul_ps(_mm_shuffle_ps(a, a, 0xB1), wi));
+}
+
+__attribute__((target("sse4.1")))
+inline void fftRadix4StageSSE41(float * d, uint32_t n, uint32_t m2, const float * w1, const float * w2)
+{
+    const __m128 negIm = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    for (uint32_t k = 0; k < n; k += 4 * m2) {
+        for (uint32_t j = 0; j < m2; j += 2) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            float * p2 = p1 + 2 * m2;
+            float * p3 = p2 + 2 * m2;
+            const __m128 vw1 = _mm_loadu_ps(w1 + 2 * j);
+            const __m128 vw2 = _mm_loadu_ps(w2 + 2 * j);
+
+            const __m128 x0 = _mm_loadu_ps(p0);
+            const __m128 t1 = fftMulSSE41(_mm_loadu_ps(p1), vw1);
+            const __m128 x2 = _mm_loadu_ps(p2);
+            const __m128 t3 = fftMulSSE41(_mm_loadu_ps(p3), vw1);
+
+            const __m128 a0 = _mm_add_ps(x0, t1);
+            const __m128 a1 = _mm_sub_ps(x0, t1);
+            const __m128 u2 = fftMulSSE41(_mm_add_ps(x2, t3), vw2);
+            __m128 u3 = fftMulSSE41(_mm_sub_ps(x2, t3), vw2);
+            u3 = _mm_xor_ps(_mm_shuffle_ps(u3, u3, 0xB1), negIm);
+
+            _mm_storeu_ps(p0, _mm_add_ps(a0, u2));
+            _mm_storeu_ps(p2, _mm_sub_ps(a0, u2));
+            _mm_storeu_ps(p1, _mm_add_ps(a1, u3));
+            _mm_storeu_ps(p3, _mm_sub_ps(a1, u3));
+        }
+    }
+}
+
+__attribute__((target("sse4.1")))
+inline void fftRadix2StageSSE41(float * d, uint32_t n, uint32_t m2, const float * w)
+{
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j += 2) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            const __m128 x0 = _mm_loadu_ps(p0);
+            const __m128 t = fftMulSSE41(_mm_loadu_ps(p1), _mm_loadu_ps(w + 2 * j));
+            _mm_storeu_ps(p0, _mm_add_ps(x0, t));
+            _mm_storeu_ps(p1, _mm_sub_ps(x0, t));
+        }
+    }
+}
+
+inline void fftRadix4SSE41(std::complex<float> * data, const fftPlan_t & plan)
+{
+    fftRadix4Run(data, plan, fftRadix4StageSSE41, fftRadix2StageSSE41);
+}
+
+// Complex numbers stay interleaved {re, im}; a product needs the duplicated
+// real and imaginary parts of w and the swapped pairs of a, and fmaddsub
+// yields {ar wr - ai wi, ai wr + ar wi} in one instruction
+
+__attribute__((target("avx2,fma")))
+inline __m256 fftMulAVX2(__m256 a, __m256 w)
+{
+    const __m256 wr = _mm256_moveldup_ps(w);
+    const __m256 wi = _mm256_movehdup_ps(w);
+    return _mm256_fmaddsub_ps(a, wr, _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), wi));
+}
+
+__attribute__((target("avx2,fma")))
+inline void fftRadix4StageAVX2(float * d, uint32_t n, uint32_t m2, const float * w1, const float * w2)
+{
+    // Multiplication by -j: swap pairs, negate the new imaginary part
+    const __m256 negIm = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+    for (uint32_t k = 0; k < n; k += 4 * m2) {
+        for (uint32_t j = 0; j < m2; j += 4) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            float * p2 = p1 + 2 * m2;
+            float * p3 = p2 + 2 * m2;
+            const __m256 vw1 = _mm256_loadu_ps(w1 + 2 * j);
+            const __m256 vw2 = _mm256_loadu_ps(w2 + 2 * j);
+
+            const __m256 x0 = _mm256_loadu_ps(p0);
+            const __m256 t1 = fftMulAVX2(_mm256_loadu_ps(p1), vw1);
+            const __m256 x2 = _mm256_loadu_ps(p2);
+            const __m256 t3 = fftMulAVX2(_mm256_loadu_ps(p3), vw1);
+
+            const __m256 a0 = _mm256_add_ps(x0, t1);
+            const __m256 a1 = _mm256_sub_ps(x0, t1);
+            const __m256 u2 = fftMulAVX2(_mm256_add_ps(x2, t3), vw2);
+            __m256 u3 = fftMulAVX2(_mm256_sub_ps(x2, t3), vw2);
+            u3 = _mm256_xor_ps(_mm256_permute_ps(u3, 0xB1), negIm);
+
+            _mm256_storeu_ps(p0, _mm256_add_ps(a0, u2));
+            _mm256_storeu_ps(p2, _mm256_sub_ps(a0, u2));
+            _mm256_storeu_ps(p1, _mm256_add_ps(a1, u3));
+            _mm256_storeu_ps(p3, _mm256_sub_ps(a1, u3));
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void fftRadix2StageAVX2(float * d, uint32_t n, uint32_t m2, const float * w)
+{
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j += 4) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            const __m256 x0 = _mm256_loadu_ps(p0);
+            const __m256 t = fftMulAVX2(_mm256_loadu_ps(p1), _mm256_loadu_ps(w + 2 * j));
+            _mm256_storeu_ps(p0, _mm256_add_ps(x0, t));
+            _mm256_storeu_ps(p1, _mm256_sub_ps(x0, t));
+        }
+    }
+}
+
+inline void fftRadix4AVX2(std::complex<float> * data, const fftPlan_t & plan)
+{
+    fftRadix4Run(data, plan, fftRadix4StageAVX2, fftRadix2StageAVX2);
+}
+
+__attribute__((target("avx512f")))
+inline __m512 fftMulAVX512(__m512 a, __m512 w)
+{
+    const __m512 wr = _mm512_moveldup_ps(w);
+    const __m512 wi = _mm512_movehdup_ps(w);
+    return _mm512_fmaddsub_ps(a, wr, _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), wi));
+}
+
+// AVX-512F processors implement AVX2 and FMA as well, 4-wide passes reuse them
+__attribute__((target("avx512f,avx2,fma")))
+inline void fftRadix4StageAVX512(float * d, uint32_t n, uint32_t m2, const float * w1, const float * w2)
+{
+    if (m2 < 8) {
+        fftRadix4StageAVX2(d, n, m2, w1, w2);
+        return;
+    }
+    // Sign flip of odd lanes through integer xor, _mm512_xor_ps needs AVX512DQ
+    const __m512i negIm = _mm512_set4_epi32((int)0x80000000, 0, (int)0x80000000, 0);
+    for (uint32_t k = 0; k < n; k += 4 * m2) {
+        for (uint32_t j = 0; j < m2; j += 8) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            float * p2 = p1 + 2 * m2;
+            float * p3 = p2 + 2 * m2;
+            const __m512 vw1 = _mm512_loadu_ps(w1 + 2 * j);
+            const __m512 vw2 = _mm512_loadu_ps(w2 + 2 * j);
+
+            const __m512 x0 = _mm512_loadu_ps(p0);
+            const __m512 t1 = fftMulAVX512(_mm512_loadu_ps(p1), vw1);
+            const __m512 x2 = _mm512_loadu_ps(p2);
+            const __m512 t3 = fftMulAVX512(_mm512_loadu_ps(p3), vw1);
+
+            const __m512 a0 = _mm512_add_ps(x0, t1);
+            const __m512 a1 = _mm512_sub_ps(x0, t1);
+            const __m512 u2 = fftMulAVX512(_mm512_add_ps(x2, t3), vw2);
+            __m512 u3 = fftMulAVX512(_mm512_sub_ps(x2, t3), vw2);
+            u3 = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_permute_ps(u3, 0xB1)), negIm));
+
+            _mm512_storeu_ps(p0, _mm512_add_ps(a0, u2));
+            _mm512_storeu_ps(p2, _mm512_sub_ps(a0, u2));
+            _mm512_storeu_ps(p1, _mm512_add_ps(a1, u3));
+            _mm512_storeu_ps(p3, _mm512_sub_ps(a1, u3));
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+inline void fftRadix2StageAVX512(float * d, uint32_t n, uint32_t m2, const float * w)
+{
+    if (m2 < 8) {
+        fftRadix2StageAVX2(d, n, m2, w);
+        return;
+    }
+    for (uint32_t k = 0; k < n; k += 2 * m2) {
+        for (uint32_t j = 0; j < m2; j += 8) {
+            float * p0 = d + 2 * (k + j);
+            float * p1 = p0 + 2 * m2;
+            const __m512 x0 = _mm512_loadu_ps(p0);
+            const __m512 t = fftMulAVX512(_mm512_loadu_ps(p1), _mm512_loadu_ps(w + 2 * j));
+            _mm512_storeu_ps(p0, _mm512_add_ps(x0, t));
+            _mm512_storeu_ps(p1, _mm512_sub_ps(x0, t));
+        }
+    }
+}
+
+inline void fftRadix4AVX512(std::complex<float> * data, const fftPlan_t & plan)
+{
+    fftRadix4Run(data, plan, fftRadix4StageAVX512, fftRadix2StageAVX512);
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Выбор наиболее широкого ядра бабочек не выше cpuLevel()
+ */
+inline CpuKernel<fftKernelFunc_t> fftKernelSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512)
+        return {fftRadix4AVX512, CpuLevel_AVX512};
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return {fftRadix4AVX2, CpuLevel_AVX2};
+    if (cpuLevel() >= CpuLevel_SSE41)
+        return {fftRadix4SSE41, CpuLevel_SSE41};
+#endif
+    return {fftRadix4Scalar, CpuLevel_Scalar};
+}
+
+inline const CpuKernel<fftKernelFunc_t> & fftKernel(void)
+{
+    static const CpuKernel<fftKernelFunc_t> kernel = fftKernelSelect();
+    return kernel;
+}
+
+/**
+ * @brief Расчёт FFT по плану векторным ядром radix-2^2
+ *
+ * Замена stdComplexFFT для результата complex<float>: загрузка с
+ * бит-реверсивной перестановкой и приведением формата отсчётов та же,
+ * бабочки выполняет ядро, выбранное один раз при первом вызове.
+ * @param a Начальный итератор отсчётов сигнала (комплексных либо целочисленных iq)
+ * @param b Непрерывный буфер результата размером plan.size()
+ * @param plan План FFT
+ * @param window Множители компонент {re, im} (FFTWindow), применяются при загрузке
+ */
+template<class InIter_T>
+void fastComplexFFT(InIter_T a, std::complex<float> * b, const fftPlan_t & plan, \
+                    const float * window = nullptr)
+{
+    const fftKernelFunc_t kernel = fftKernel().func;
+    const uint32_t n = plan.size();
+    const uint32_t * reverse = plan.reverse();
+    if (window != nullptr) {
+        for (uint32_t i = 0; i < n; ++i) {
+            const std::complex<float> x = toComplex<std::complex<float>>(a[i]);
+            b[reverse[i]] = std::complex<float>(x.real() * window[2 * i], x.imag() * window[2 * i + 1]);
+        }
+    } else {
+        for (uint32_t i = 0; i < n; ++i) {
+            b[reverse[i]] = toComplex<std::complex<float>>(a[i]);
+        }
+    }
+    kernel(b, plan);
+}
+
+// =============================================================================
+// Real-input spectrum from a half-size complex FFT
+// =============================================================================
+//
+// z is the m-point FFT of pairs z[k] = x[2k] + j x[2k + 1] of a real signal x.
+// Even and odd samples are split by the symmetry of z[k] and conj(z[m - k])
+// and joined by the last butterfly stage of the 2m-point transform:
+//
+//   E = (z[k] + conj(z[m - k])) / 2,  O = (z[k] - conj(z[m - k])) / 2j
+//   X[k] = E + W(2m, k) O,  k < m
+//
+// which is the non-redundant half spectrum without the Nyquist bin.
+
+typedef void (*fftUnpackFunc_t)(const std::complex<float> * z, std::complex<float> * x, \
+                                const std::complex<float> * w, uint32_t m);
+
+inline void fftRealUnpackRange(const std::complex<float> * z, std::complex<float> * x, \
+                               const std::complex<float> * w, uint32_t m, uint32_t first, uint32_t last)
+{
+    for (uint32_t k = first; k < last; k++) {
+        const uint32_t mirror = k == 0 ? 0 : m - k;
+        const float ar = z[k].real();
+        const float ai = z[k].imag();
+        const float br = z[mirror].real();
+        const float bi = -z[mirror].imag();
+        const float er = 0.5f * (ar + br);
+        const float ei = 0.5f * (ai + bi);
+        const float orr = 0.5f * (ai - bi);
+        const float oi = 0.5f * (br - ar);
+        const float wr = w[k].real();
+        const float wi = w[k].imag();
+        x[k] = std::complex<float>(er + wr * orr - wi * oi, ei + wr * oi + wi * orr);
+    }
+}
+
+inline void fftRealUnpackScalar(const std::complex<float> * z, std::complex<float> * x, \
+                                const std::complex<float> * w, uint32_t m)
+{
+    fftRealUnpackRange(z, x, w, m, 0, m);
+}
+
+#ifdef IQCONVERT_X86
+__attribute__((target("avx2,fma")))
+inline void fftRealUnpackAVX2(const std::complex<float> * z, std::complex<float> * x, \
+                              const std::complex<float> * w, uint32_t m)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 negIm = _mm256_castsi256_ps(_mm256_set1_epi64x((int64_t)0x8000000000000000LL));
+
+    // Bin 0 mirrors onto itself, blocks of 4 start right after it
+    fftRealUnpackRange(z, x, w, m, 0, 1);
+    uint32_t k = 1;
+    for (; k + 4 <= m; k += 4) {
+        const float * pz = reinterpret_cast<const float *>(z + k);
+        const float * pb = reinterpret_cast<const float *>(z + m - k - 3);
+        const __m256 a = _mm256_loadu_ps(pz);
+        // z[m - k - j] for j = 0..3: reverse the complex order, conjugate
+        __m256 b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_loadu_ps(pb)), 0x1B));
+        b = _mm256_xor_ps(b, negIm);
+
+        const __m256 e = _mm256_mul_ps(half, _mm256_add_ps(a, b));
+        const __m256 d = _mm256_mul_ps(half, _mm256_sub_ps(a, b));
+        // d / j = {d.im, -d.re}
+        const __m256 o = _mm256_xor_ps(_mm256_permute_ps(d, 0xB1), negIm);
+        _mm256_storeu_ps(reinterpret_cast<float *>(x + k), \
+                         _mm256_add_ps(e, fftMulAVX2(o, _mm256_loadu_ps(reinterpret_cast<const float *>(w + k)))));
+    }
+    fftRealUnpackRange(z, x, w, m, k, m);
+}
+#endif // IQCONVERT_X86
+
+inline CpuKernel<fftUnpackFunc_t> fftRealUnpackSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return {fftRealUnpackAVX2, CpuLevel_AVX2};
+#endif
+    return {fftRealUnpackScalar, CpuLevel_Scalar};
+}
+
+inline const CpuKernel<fftUnpackFunc_t> & fftRealUnpackKernel(void)
+{
+    static const CpuKernel<fftUnpackFunc_t> kernel = fftRealUnpackSelect();
+    return kernel;
+}
+
+/**
+ * @brief Спектр вещественного сигнала из FFT половинного размера
+ * @param z FFT размера m от пар соседних вещественных отсчётов
+ * @param x Бины 0..m - 1 FFT размера 2m, не пересекается с z
+ * @param w Множители exp(-j pi k / m), k < m: ступень m плана размера 2m
+ * либо FFTMixedPlan::halfTwiddles() для m, отличного от степени двойки
+ * @param m Размер FFT пар
+ */
+inline void fftRealUnpack(const std::complex<float> * z, std::complex<float> * x, \
+                          const std::complex<float> * w, uint32_t m)
+{
+    fftRealUnpackKernel().func(z, x, w, m);
+}
+
+// =============================================================================
+// Batched FFT over several rows in structure-of-arrays layout
+// =============================================================================
+//
+// width rows of one size are transformed together: point i of row r lives in
+// re[i * width + r] and im[i * width + r], so one vector register holds the
+// same point of every row. All rows share the twiddles, which are broadcast,
+// and every stage (including the first ones) runs on full registers without
+// shuffles. Stage order is the same as in fftRadix4Run.
+//
+// Rows are converted to float in place in the output buffer, moved into the
+// work area by a gathering load (bit reversal included) and scattered back
+// after the transform. Row stride and the im half of the work area are padded
+// by a cache line: with power-of-two spacing all rows of a point would fall
+// into one cache set.
+
+static constexpr int fftBatchMinOrder = 4;
+static constexpr size_t fftBatchPad = 16;
+
+typedef void (*fftBatchFunc_t)(float * re, float * im, const fftPlan_t & plan);
+typedef void (*fftBatchLoadFunc_t)(const std::complex<float> * rows, size_t stride, \
+                                   const fftPlan_t & plan, float * re, float * im);
+typedef void (*fftBatchStoreFunc_t)(const float * re, const float * im, \
+                                    const fftPlan_t & plan, std::complex<float> * rows, size_t stride);
+
+/**
+ * @brief Ядро пакетного FFT и количество строк, обрабатываемых за вызов
+ */
+struct FFTBatchKernel {
+    fftBatchFunc_t func{nullptr};
+    fftBatchLoadFunc_t load{nullptr};
+    fftBatchStoreFunc_t store{nullptr};
+    size_t width{0};
+    int maxOrder{0};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+/**
+ * @brief Шаг строк буфера результата пакетного FFT, элементов
+ */
+inline size_t fftBatchStride(size_t n)
+{
+    return n + fftBatchPad / 2;
+}
+
+/**
+ * @brief Размер рабочего буфера пакетного FFT, float
+ */
+inline size_t fftBatchWorkSize(size_t n, size_t width)
+{
+    return 2 * n * width + fftBatchPad;
+}
+
+#ifdef IQCONVERT_X86
+__attribute__((target("avx2,fma")))
+inline void fftBatchAVX2(float * re, float * im, const fftPlan_t & plan)
+{
+    constexpr uint32_t L = 8;
+    const uint32_t n = plan.size();
+
+    uint32_t m2 = 1;
+    for (; 4 * m2 <= n; m2 <<= 2) {
+        const float * w1 = reinterpret_cast<const float *>(plan.stageTwiddles(m2));
+        const float * w2 = reinterpret_cast<const float *>(plan.stageTwiddles(2 * m2));
+        for (uint32_t base = 0; base < n; base += 4 * m2) {
+            for (uint32_t j = 0; j < m2; j++) {
+                const __m256 w1r = _mm256_broadcast_ss(w1 + 2 * j), w1i = _mm256_broadcast_ss(w1 + 2 * j + 1);
+                const __m256 w2r = _mm256_broadcast_ss(w2 + 2 * j), w2i = _mm256_broadcast_ss(w2 + 2 * j + 1);
+                const uint32_t k = base + j;
+                const size_t i0 = k * L, i1 = (k + m2) * L, i2 = (k + 2 * m2) * L, i3 = (k + 3 * m2) * L;
+                const __m256 x1r = _mm256_loadu_ps(re + i1), x1i = _mm256_loadu_ps(im + i1);
+                const __m256 x3r = _mm256_loadu_ps(re + i3), x3i = _mm256_loadu_ps(im + i3);
+                const __m256 t1r = _mm256_fmsub_ps(x1r, w1r, _mm256_mul_ps(x1i, w1i));
+                const __m256 t1i = _mm256_fmadd_ps(x1r, w1i, _mm256_mul_ps(x1i, w1r));
+                const __m256 t3r = _mm256_fmsub_ps(x3r, w1r, _mm256_mul_ps(x3i, w1i));
+                const __m256 t3i = _mm256_fmadd_ps(x3r, w1i, _mm256_mul_ps(x3i, w1r));
+
+                const __m256 x0r = _mm256_loadu_ps(re + i0), x0i = _mm256_loadu_ps(im + i0);
+                const __m256 x2r = _mm256_loadu_ps(re + i2), x2i = _mm256_loadu_ps(im + i2);
+                const __m256 a0r = _mm256_add_ps(x0r, t1r), a0i = _mm256_add_ps(x0i, t1i);
+                const __m256 a1r = _mm256_sub_ps(x0r, t1r), a1i = _mm256_sub_ps(x0i, t1i);
+                const __m256 a2r = _mm256_add_ps(x2r, t3r), a2i = _mm256_add_ps(x2i, t3i);
+                const __m256 a3r = _mm256_sub_ps(x2r, t3r), a3i = _mm256_sub_ps(x2i, t3i);
+
+                const __m256 u2r = _mm256_fmsub_ps(a2r, w2r, _mm256_mul_ps(a2i, w2i));
+                const __m256 u2i = _mm256_fmadd_ps(a2r, w2i, _mm256_mul_ps(a2i, w2r));
+                // w2 * a3' * (-j) = {im, -re} of the product
+                const __m256 u3r = _mm256_fmadd_ps(a3r, w2i, _mm256_mul_ps(a3i, w2r));
+                const __m256 u3i = _mm256_fmsub_ps(a3i, w2i, _mm256_mul_ps(a3r, w2r));
+
+                _mm256_storeu_ps(re + i0, _mm256_add_ps(a0r, u2r));
+                _mm256_storeu_ps(im + i0, _mm256_add_ps(a0i, u2i));
+                _mm256_storeu_ps(re + i2, _mm256_sub_ps(a0r, u2r));
+                _mm256_storeu_ps(im + i2, _mm256_sub_ps(a0i, u2i));
+                _mm256_storeu_ps(re + i1, _mm256_add_ps(a1r, u3r));
+                _mm256_storeu_ps(im + i1, _mm256_add_ps(a1i, u3i));
+                _mm256_storeu_ps(re + i3, _mm256_sub_ps(a1r, u3r));
+                _mm256_storeu_ps(im + i3, _mm256_sub_ps(a1i, u3i));
+            }
+        }
+    }
+    if (m2 < n) {
+        const float * w = reinterpret_cast<const float *>(plan.stageTwiddles(m2));
+        for (uint32_t j = 0; j < m2; j++) {
+            const __m256 wr = _mm256_broadcast_ss(w + 2 * j), wi = _mm256_broadcast_ss(w + 2 * j + 1);
+            const size_t i0 = j * L, i1 = (j + m2) * L;
+            const __m256 x1r = _mm256_loadu_ps(re + i1), x1i = _mm256_loadu_ps(im + i1);
+            const __m256 tr = _mm256_fmsub_ps(x1r, wr, _mm256_mul_ps(x1i, wi));
+            const __m256 ti = _mm256_fmadd_ps(x1r, wi, _mm256_mul_ps(x1i, wr));
+            const __m256 x0r = _mm256_loadu_ps(re + i0), x0i = _mm256_loadu_ps(im + i0);
+            _mm256_storeu_ps(re + i0, _mm256_add_ps(x0r, tr));
+            _mm256_storeu_ps(im + i0, _mm256_add_ps(x0i, ti));
+            _mm256_storeu_ps(re + i1, _mm256_sub_ps(x0r, tr));
+            _mm256_storeu_ps(im + i1, _mm256_sub_ps(x0i, ti));
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void fftBatchAVX512(float * re, float * im, const fftPlan_t & plan)
+{
+    constexpr uint32_t L = 16;
+    const uint32_t n = plan.size();
+
+    uint32_t m2 = 1;
+    for (; 4 * m2 <= n; m2 <<= 2) {
+        const float * w1 = reinterpret_cast<const float *>(plan.stageTwiddles(m2));
+        const float * w2 = reinterpret_cast<const float *>(plan.stageTwiddles(2 * m2));
+        for (uint32_t base = 0; base < n; base += 4 * m2) {
+            for (uint32_t j = 0; j < m2; j++) {
+                const __m512 w1r = _mm512_set1_ps(w1[2 * j]), w1i = _mm512_set1_ps(w1[2 * j + 1]);
+                const __m512 w2r = _mm512_set1_ps(w2[2 * j]), w2i = _mm512_set1_ps(w2[2 * j + 1]);
+                const uint32_t k = base + j;
+                const size_t i0 = k * L, i1 = (k + m2) * L, i2 = (k + 2 * m2) * L, i3 = (k + 3 * m2) * L;
+                const __m512 x1r = _mm512_loadu_ps(re + i1), x1i = _mm512_loadu_ps(im + i1);
+                const __m512 x3r = _mm512_loadu_ps(re + i3), x3i = _mm512_loadu_ps(im + i3);
+                const __m512 t1r = _mm512_fmsub_ps(x1r, w1r, _mm512_mul_ps(x1i, w1i));
+                const __m512 t1i = _mm512_fmadd_ps(x1r, w1i, _mm512_mul_ps(x1i, w1r));
+                const __m512 t3r = _mm512_fmsub_ps(x3r, w1r, _mm512_mul_ps(x3i, w1i));
+                const __m512 t3i = _mm512_fmadd_ps(x3r, w1i, _mm512_mul_ps(x3i, w1r));
+
+                const __m512 x0r = _mm512_loadu_ps(re + i0), x0i = _mm512_loadu_ps(im + i0);
+                const __m512 x2r = _mm512_loadu_ps(re + i2), x2i = _mm512_loadu_ps(im + i2);
+                const __m512 a0r = _mm512_add_ps(x0r, t1r), a0i = _mm512_add_ps(x0i, t1i);
+                const __m512 a1r = _mm512_sub_ps(x0r, t1r), a1i = _mm512_sub_ps(x0i, t1i);
+                const __m512 a2r = _mm512_add_ps(x2r, t3r), a2i = _mm512_add_ps(x2i, t3i);
+                const __m512 a3r = _mm512_sub_ps(x2r, t3r), a3i = _mm512_sub_ps(x2i, t3i);
+
+                const __m512 u2r = _mm512_fmsub_ps(a2r, w2r, _mm512_mul_ps(a2i, w2i));
+                const __m512 u2i = _mm512_fmadd_ps(a2r, w2i, _mm512_mul_ps(a2i, w2r));
+                const __m512 u3r = _mm512_fmadd_ps(a3r, w2i, _mm512_mul_ps(a3i, w2r));
+                const __m512 u3i = _mm512_fmsub_ps(a3i, w2i, _mm512_mul_ps(a3r, w2r));
+
+                _mm512_storeu_ps(re + i0, _mm512_add_ps(a0r, u2r));
+                _mm512_storeu_ps(im + i0, _mm512_add_ps(a0i, u2i));
+                _mm512_storeu_ps(re + i2, _mm512_sub_ps(a0r, u2r));
+                _mm512_storeu_ps(im + i2, _mm512_sub_ps(a0i, u2i));
+                _mm512_storeu_ps(re + i1, _mm512_add_ps(a1r, u3r));
+                _mm512_storeu_ps(im + i1, _mm512_add_ps(a1i, u3i));
+                _mm512_storeu_ps(re + i3, _mm512_sub_ps(a1r, u3r));
+                _mm512_storeu_ps(im + i3, _mm512_sub_ps(a1i, u3i));
+            }
+        }
+    }
+    if (m2 < n) {
+        const float * w = reinterpret_cast<const float *>(plan.stageTwiddles(m2));
+        for (uint32_t j = 0; j < m2; j++) {
+            const __m512 wr = _mm512_set1_ps(w[2 * j]), wi = _mm512_set1_ps(w[2 * j + 1]);
+            const size_t i0 = j * L, i1 = (j + m2) * L;
+            const __m512 x1r = _mm512_loadu_ps(re + i1), x1i = _mm512_loadu_ps(im + i1);
+            const __m512 tr = _mm512_fmsub_ps(x1r, wr, _mm512_mul_ps(x1i, wi));
+            const __m512 ti = _mm512_fmadd_ps(x1r, wi, _mm512_mul_ps(x1i, wr));
+            const __m512 x0r = _mm512_loadu_ps(re + i0), x0i = _mm512_loadu_ps(im + i0);
+            _mm512_storeu_ps(re + i0, _mm512_add_ps(x0r, tr));
+            _mm512_storeu_ps(im + i0, _mm512_add_ps(x0i, ti));
+            _mm512_storeu_ps(re + i1, _mm512_sub_ps(x0r, tr));
+            _mm512_storeu_ps(im + i1, _mm512_sub_ps(x0i, ti));
+        }
+    }
+}
+__attribute__((target("avx2")))
+inline void fftBatchLoadAVX2(const std::complex<float> * rows, size_t stride, \
+                             const fftPlan_t & plan, float * re, float * im)
+{
+    const uint32_t n = plan.size();
+    const uint32_t * reverse = plan.reverse();
+    const float * base = reinterpret_cast<const float *>(rows);
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), \
+                                             _mm256_set1_epi32((int)(2 * stride)));
+    for (uint32_t i = 0; i < n; i++) {
+        const size_t point = (size_t)reverse[i] * 8;
+        _mm256_storeu_ps(re + point, _mm256_i32gather_ps(base + 2 * i, index, 4));
+        _mm256_storeu_ps(im + point, _mm256_i32gather_ps(base + 2 * i + 1, index, 4));
+    }
+}
+
+__attribute__((target("avx2")))
+inline void fftBatchStoreAVX2(const float * re, const float * im, \
+                              const fftPlan_t & plan, std::complex<float> * rows, size_t stride)
+{
+    const uint32_t n = plan.size();
+    for (uint32_t i = 0; i < n; i++) {
+        const __m256 r = _mm256_loadu_ps(re + (size_t)i * 8);
+        const __m256 m = _mm256_loadu_ps(im + (size_t)i * 8);
+        // {r0 m0 r1 m1 | r4 m4 r5 m5} and {r2 m2 r3 m3 | r6 m6 r7 m7}
+        const __m256 lo = _mm256_unpacklo_ps(r, m);
+        const __m256 hi = _mm256_unpackhi_ps(r, m);
+        const __m128 parts[4] = {_mm256_castps256_ps128(lo), _mm256_castps256_ps128(hi), \
+                                 _mm256_extractf128_ps(lo, 1), _mm256_extractf128_ps(hi, 1)};
+        for (size_t q = 0; q < 4; q++) {
+            _mm_storel_pi(reinterpret_cast<__m64 *>(rows + (2 * q) * stride + i), parts[q]);
+            _mm_storeh_pi(reinterpret_cast<__m64 *>(rows + (2 * q + 1) * stride + i), parts[q]);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void fftBatchLoadAVX512(const std::complex<float> * rows, size_t stride, \
+                               const fftPlan_t & plan, float * re, float * im)
+{
+    const uint32_t n = plan.size();
+    const uint32_t * reverse = plan.reverse();
+    const float * base = reinterpret_cast<const float *>(rows);
+    const __m512i index = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, \
+                                                               8, 9, 10, 11, 12, 13, 14, 15), \
+                                             _mm512_set1_epi32((int)(2 * stride)));
+    for (uint32_t i = 0; i < n; i++) {
+        const size_t point = (size_t)reverse[i] * 16;
+        _mm512_storeu_ps(re + point, _mm512_i32gather_ps(index, base + 2 * i, 4));
+        _mm512_storeu_ps(im + point, _mm512_i32gather_ps(index, base + 2 * i + 1, 4));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void fftBatchStoreAVX512(const float * re, const float * im, \
+                                const fftPlan_t & plan, std::complex<float> * rows, size_t stride)
+{
+    const uint32_t n = plan.size();
+    // Complex values are scattered as 64-bit elements, 8 rows per scatter
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), \
+                                             _mm256_set1_epi32((int)stride));
+    const __m512i lo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i hi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    double * out = reinterpret_cast<double *>(rows);
+    for (uint32_t i = 0; i < n; i++) {
+        const __m512 r = _mm512_loadu_ps(re + (size_t)i * 16);
+        const __m512 m = _mm512_loadu_ps(im + (size_t)i * 16);
+        _mm512_i32scatter_pd(out + i, index, _mm512_castps_pd(_mm512_permutex2var_ps(r, lo, m)), 8);
+        _mm512_i32scatter_pd(out + 8 * stride + i, index, _mm512_castps_pd(_mm512_permutex2var_ps(r, hi, m)), 8);
+    }
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Выбор пакетного ядра; без векторных расширений пакетный режим
+ * не используется (width = 0)
+ *
+ * Выше maxOrder рабочая область уходит из L1 и транспонирование съедает
+ * выигрыш, ниже fftBatchMinOrder однострочное ядро и так быстрее.
+ */
+inline FFTBatchKernel fftBatchSelect(void)
+{
+    FFTBatchKernel kernel;
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512) {
+        kernel.func = fftBatchAVX512;
+        kernel.load = fftBatchLoadAVX512;
+        kernel.store = fftBatchStoreAVX512;
+        kernel.width = 16;
+        kernel.maxOrder = 10;
+        kernel.level = CpuLevel_AVX512;
+    } else if (cpuLevel() >= CpuLevel_AVX2) {
+        kernel.func = fftBatchAVX2;
+        kernel.load = fftBatchLoadAVX2;
+        kernel.store = fftBatchStoreAVX2;
+        kernel.width = 8;
+        kernel.maxOrder = 9;
+        kernel.level = CpuLevel_AVX2;
+    }
+#endif
+    return kernel;
+}
+
+inline const FFTBatchKernel & fftBatchKernel(void)
+{
+    static const FFTBatchKernel kernel = fftBatchSelect();
+    return kernel;
+}
+
+/**
+ * @brief Пакетный расчёт FFT для fftBatchKernel().width соседних строк
+ * @param first Первый отсчёт первой строки
+ * @param step Шаг между началами строк в отсчётах
+ * @param dc Постоянная составляющая, вычитаемая при загрузке
+ * @param out Результат: спектр строки r начинается с out[r * fftBatchStride(n)]
+ * @param work Рабочий буфер на fftBatchWorkSize(n, width) float
+ * @param plan План FFT
+ * @param window Множители компонент {re, im} (FFTWindow), nullptr - без окна
+ */
+template<class Sample_T>
+void fastComplexFFTBatch(const Sample_T * first, size_t step, std::complex<float> dc, \
+                         std::complex<float> * out, float * work, const fftPlan_t & plan, \
+                         const float * window = nullptr)
+{
+    const FFTBatchKernel & kernel = fftBatchKernel();
+    const uint32_t n = plan.size();
+    const size_t stride = fftBatchStride(n);
+    float * re = work;
+    float * im = work + (size_t)n * kernel.width + fftBatchPad;
+
+    for (size_t r = 0; r < kernel.width; r++) {
+        sampleConvert(first + r * step, out + r * stride, n, 1.0f, dc, window);
+    }
+    kernel.load(out, stride, plan, re, im);
+    kernel.func(re, im, plan);
+    kernel.store(re, im, plan, out, stride);
+}
+
+// =============================================================================
+
+#endif // FFTKERNEL_HPP
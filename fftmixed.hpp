@@ -0,0 +1,599 @@
+#ifndef FFTMIXED_HPP
+#define FFTMIXED_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <string>
+
+#include "fftkernel.hpp"
+
+// =============================================================================
+// Mixed-radix and Bluestein FFT for sizes other than 2^n
+// =============================================================================
+//
+// Sizes made of factors 2, 3, 5 and 7 run as a Stockham autosort FFT: every
+// pass takes the sequence of length n = m * p with stride s, does the p-point
+// DFTs over x[s * (q + m * k) + r], multiplies the outputs by W(n, q * j) and
+// writes them to y[s * (p * q + j) + r]. Results come out in natural order,
+// without a permutation pass. Vector kernels run four r at a time once
+// s >= 4 and four q at a time in the first pass (s = 1), so the largest
+// radix goes first to get past the short strides in one pass.
+//
+// Sizes with any other prime factor go through Bluestein's chirp-z algorithm
+// on top of the power-of-two kernels: n k = (k^2 + n^2 - (k - n)^2) / 2
+// turns the DFT into a convolution with the chirp exp(j pi k^2 / n), done as
+// two FFTs of size 2^m >= 2n - 1.
+//
+// Arithmetic is component-wise on float arrays as in the power-of-two
+// kernels: complex temporaries get spilled and reloaded as a whole, which
+// stalls store forwarding on every element.
+
+inline bool fftIsPow2(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * @brief Проход Stockham с основанием radix
+ */
+struct FFTMixedPass {
+    uint32_t radix;
+    uint32_t m;
+    uint32_t s;
+    // W(n, q * j) at (j - 1) * m + q, j = 1..radix - 1, q < m
+    std::vector<std::complex<float>> twiddles;
+    // Odd radices: cos and sin of 2 pi j k / radix at (k - 1) * h + j - 1,
+    // j, k = 1..h, h = (radix - 1) / 2
+    std::vector<float> cosines;
+    std::vector<float> sines;
+};
+
+/**
+ * @brief Сигнатура прохода
+ * @param pass Параметры прохода
+ * @param x Входная последовательность
+ * @param y Результат прохода, не пересекается с x
+ */
+typedef void (*fftMixedPassFunc_t)(const FFTMixedPass & pass, const float * x, float * y);
+
+// Scalar passes cover q >= q0, r >= r0, vector kernels leave their tails here
+
+inline void fftMixedPass2Scalar(const FFTMixedPass & pass, const float * x, float * y, uint32_t q0, uint32_t r0)
+{
+    const uint32_t m = pass.m, s = pass.s;
+    const float * w = reinterpret_cast<const float *>(pass.twiddles.data());
+    for (uint32_t q = q0; q < m; q++) {
+        const float wr = w[2 * q], wi = w[2 * q + 1];
+        const float * a0 = x + 2 * (size_t)s * q;
+        const float * a1 = a0 + 2 * (size_t)s * m;
+        float * y0 = y + 4 * (size_t)s * q;
+        float * y1 = y0 + 2 * (size_t)s;
+        for (uint32_t r = 2 * r0; r < 2 * s; r += 2) {
+            const float dr = a0[r] - a1[r], di = a0[r + 1] - a1[r + 1];
+            y0[r] = a0[r] + a1[r];
+            y0[r + 1] = a0[r + 1] + a1[r + 1];
+            y1[r] = wr * dr - wi * di;
+            y1[r + 1] = wr * di + wi * dr;
+        }
+    }
+}
+
+inline void fftMixedPass4Scalar(const FFTMixedPass & pass, const float * x, float * y, uint32_t q0, uint32_t r0)
+{
+    const uint32_t m = pass.m, s = pass.s;
+    const size_t sm = 2 * (size_t)s * m;
+    const float * w = reinterpret_cast<const float *>(pass.twiddles.data());
+    for (uint32_t q = q0; q < m; q++) {
+        const float w1r = w[2 * q], w1i = w[2 * q + 1];
+        const float w2r = w[2 * (m + q)], w2i = w[2 * (m + q) + 1];
+        const float w3r = w[2 * (2 * m + q)], w3i = w[2 * (2 * m + q) + 1];
+        const float * a0 = x + 2 * (size_t)s * q;
+        float * y0 = y + 8 * (size_t)s * q;
+        float * y1 = y0 + 2 * (size_t)s;
+        float * y2 = y1 + 2 * (size_t)s;
+        float * y3 = y2 + 2 * (size_t)s;
+        for (uint32_t r = 2 * r0; r < 2 * s; r += 2) {
+            const float x0r = a0[r], x0i = a0[r + 1];
+            const float x1r = a0[r + sm], x1i = a0[r + sm + 1];
+            const float x2r = a0[r + 2 * sm], x2i = a0[r + 2 * sm + 1];
+            const float x3r = a0[r + 3 * sm], x3i = a0[r + 3 * sm + 1];
+            const float s02r = x0r + x2r, s02i = x0i + x2i;
+            const float d02r = x0r - x2r, d02i = x0i - x2i;
+            const float s13r = x1r + x3r, s13i = x1i + x3i;
+            // -j (x1 - x3)
+            const float d13r = x1i - x3i, d13i = x3r - x1r;
+            const float b1r = d02r + d13r, b1i = d02i + d13i;
+            const float b2r = s02r - s13r, b2i = s02i - s13i;
+            const float b3r = d02r - d13r, b3i = d02i - d13i;
+            y0[r] = s02r + s13r;
+            y0[r + 1] = s02i + s13i;
+            y1[r] = w1r * b1r - w1i * b1i;
+            y1[r + 1] = w1r * b1i + w1i * b1r;
+            y2[r] = w2r * b2r - w2i * b2i;
+            y2[r + 1] = w2r * b2i + w2i * b2r;
+            y3[r] = w3r * b3r - w3i * b3i;
+            y3[r + 1] = w3r * b3i + w3i * b3r;
+        }
+    }
+}
+
+// Odd prime radix from the symmetric pairs a[j] +- a[p - j]:
+//   y[k] = a[0] + sum c(jk) (a[j] + a[p - j]) - j sum s(jk) (a[j] - a[p - j])
+//   y[p - k] is the same with +j
+template<uint32_t P>
+inline void fftMixedPassOddScalar(const FFTMixedPass & pass, const float * x, float * y, uint32_t q0, uint32_t r0)
+{
+    constexpr uint32_t H = (P - 1) / 2;
+    const float * c = pass.cosines.data();
+    const float * sn = pass.sines.data();
+    const uint32_t m = pass.m, s = pass.s;
+    const size_t sm = 2 * (size_t)s * m;
+    const float * w = reinterpret_cast<const float *>(pass.twiddles.data());
+    for (uint32_t q = q0; q < m; q++) {
+        const float * a0 = x + 2 * (size_t)s * q;
+        float * y0 = y + 2 * (size_t)s * P * q;
+        for (uint32_t r = 2 * r0; r < 2 * s; r += 2) {
+            float sr[H], si[H], dr[H], di[H];
+            const float x0r = a0[r], x0i = a0[r + 1];
+            float y0r = x0r, y0i = x0i;
+            for (uint32_t j = 0; j < H; j++) {
+                const float * u = a0 + r + (j + 1) * sm;
+                const float * v = a0 + r + (P - 1 - j) * sm;
+                sr[j] = u[0] + v[0];
+                si[j] = u[1] + v[1];
+                dr[j] = u[0] - v[0];
+                di[j] = u[1] - v[1];
+                y0r += sr[j];
+                y0i += si[j];
+            }
+            y0[r] = y0r;
+            y0[r + 1] = y0i;
+            for (uint32_t k = 0; k < H; k++) {
+                float ar = x0r, ai = x0i, br = 0, bi = 0;
+                for (uint32_t j = 0; j < H; j++) {
+                    ar += c[k * H + j] * sr[j];
+                    ai += c[k * H + j] * si[j];
+                    br += sn[k * H + j] * dr[j];
+                    bi += sn[k * H + j] * di[j];
+                }
+                // a - j b and a + j b
+                const float ur = ar + bi, ui = ai - br;
+                const float vr = ar - bi, vi = ai + br;
+                const float * wu = w + 2 * ((size_t)k * m + q);
+                const float * wv = w + 2 * ((size_t)(P - 2 - k) * m + q);
+                float * yu = y0 + r + 2 * (size_t)(k + 1) * s;
+                float * yv = y0 + r + 2 * (size_t)(P - 1 - k) * s;
+                yu[0] = wu[0] * ur - wu[1] * ui;
+                yu[1] = wu[0] * ui + wu[1] * ur;
+                yv[0] = wv[0] * vr - wv[1] * vi;
+                yv[1] = wv[0] * vi + wv[1] * vr;
+            }
+        }
+    }
+}
+
+template<uint32_t P>
+inline void fftMixedPassScalar(const FFTMixedPass & pass, const float * x, float * y, uint32_t q0, uint32_t r0)
+{
+    if constexpr (P == 2) {
+        fftMixedPass2Scalar(pass, x, y, q0, r0);
+    } else if constexpr (P == 4) {
+        fftMixedPass4Scalar(pass, x, y, q0, r0);
+    } else {
+        fftMixedPassOddScalar<P>(pass, x, y, q0, r0);
+    }
+}
+
+template<uint32_t P>
+inline void fftMixedPassScalar(const FFTMixedPass & pass, const float * x, float * y)
+{
+    fftMixedPassScalar<P>(pass, x, y, 0, 0);
+}
+
+#ifdef IQCONVERT_X86
+// One __m256 holds four complex values: four r of the same q with broadcast
+// twiddles, or four consecutive q of the first pass with their own twiddles.
+// First-pass outputs y[p * q + j] are spread by p and go out through a
+// small transpose buffer.
+
+// Multiplication by -j and +j: swap pairs, negate one of the parts
+__attribute__((target("avx2,fma")))
+inline __m256 fftMixedMulNegJAVX2(__m256 a)
+{
+    const __m256 negIm = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+    return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), negIm);
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256 fftMixedMulJAVX2(__m256 a)
+{
+    const __m256 negRe = _mm256_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+    return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), negRe);
+}
+
+// P-point DFT of a[0..P) in place
+template<uint32_t P>
+__attribute__((target("avx2,fma")))
+inline void fftMixedDFTAVX2(__m256 * a, const float * c, const float * sn)
+{
+    if constexpr (P == 2) {
+        const __m256 u = a[0];
+        a[0] = _mm256_add_ps(u, a[1]);
+        a[1] = _mm256_sub_ps(u, a[1]);
+    } else if constexpr (P == 4) {
+        const __m256 s02 = _mm256_add_ps(a[0], a[2]);
+        const __m256 d02 = _mm256_sub_ps(a[0], a[2]);
+        const __m256 s13 = _mm256_add_ps(a[1], a[3]);
+        const __m256 d13 = fftMixedMulNegJAVX2(_mm256_sub_ps(a[1], a[3]));
+        a[0] = _mm256_add_ps(s02, s13);
+        a[1] = _mm256_add_ps(d02, d13);
+        a[2] = _mm256_sub_ps(s02, s13);
+        a[3] = _mm256_sub_ps(d02, d13);
+    } else {
+        constexpr uint32_t H = (P - 1) / 2;
+        __m256 sum[H], dif[H];
+        __m256 y0 = a[0];
+        for (uint32_t j = 0; j < H; j++) {
+            sum[j] = _mm256_add_ps(a[j + 1], a[P - 1 - j]);
+            dif[j] = _mm256_sub_ps(a[j + 1], a[P - 1 - j]);
+            y0 = _mm256_add_ps(y0, sum[j]);
+        }
+        for (uint32_t k = 0; k < H; k++) {
+            __m256 re = a[0];
+            __m256 im = _mm256_setzero_ps();
+            for (uint32_t j = 0; j < H; j++) {
+                re = _mm256_fmadd_ps(_mm256_set1_ps(c[k * H + j]), sum[j], re);
+                im = _mm256_fmadd_ps(_mm256_set1_ps(sn[k * H + j]), dif[j], im);
+            }
+            a[k + 1] = _mm256_add_ps(re, fftMixedMulNegJAVX2(im));
+            a[P - 1 - k] = _mm256_add_ps(re, fftMixedMulJAVX2(im));
+        }
+        a[0] = y0;
+    }
+}
+
+template<uint32_t P>
+__attribute__((target("avx2,fma")))
+inline void fftMixedPassAVX2(const FFTMixedPass & pass, const float * x, float * y)
+{
+    const float * c = pass.cosines.data();
+    const float * sn = pass.sines.data();
+    const uint32_t m = pass.m, s = pass.s;
+    const size_t sm = 2 * (size_t)s * m;
+    const float * w = reinterpret_cast<const float *>(pass.twiddles.data());
+    __m256 a[P];
+
+    if (s == 1) {
+        // Four consecutive q: inputs and twiddles are contiguous in q
+        alignas(32) float out[P][8];
+        const uint32_t blocks = m & ~3u;
+        for (uint32_t q = 0; q < blocks; q += 4) {
+            for (uint32_t k = 0; k < P; k++) {
+                a[k] = _mm256_loadu_ps(x + 2 * ((size_t)k * m + q));
+            }
+            fftMixedDFTAVX2<P>(a, c, sn);
+            _mm256_store_ps(out[0], a[0]);
+            for (uint32_t j = 1; j < P; j++) {
+                _mm256_store_ps(out[j], fftMulAVX2(a[j], _mm256_loadu_ps(w + 2 * ((size_t)(j - 1) * m + q))));
+            }
+            float * y0 = y + 2 * (size_t)P * q;
+            for (uint32_t i = 0; i < 4; i++) {
+                for (uint32_t j = 0; j < P; j++) {
+                    std::memcpy(y0 + 2 * (i * P + j), out[j] + 2 * i, 2 * sizeof(float));
+                }
+            }
+        }
+        fftMixedPassScalar<P>(pass, x, y, blocks, 0);
+        return;
+    }
+
+    // Four consecutive r of the same q share the twiddles
+    const uint32_t lanes = s & ~3u;
+    for (uint32_t q = 0; lanes != 0 && q < m; q++) {
+        __m256 tw[P];
+        for (uint32_t j = 1; j < P; j++) {
+            tw[j] = _mm256_castpd_ps(_mm256_broadcast_sd(reinterpret_cast<const double *>(w + 2 * ((size_t)(j - 1) * m + q))));
+        }
+        const float * a0 = x + 2 * (size_t)s * q;
+        float * y0 = y + 2 * (size_t)s * P * q;
+        for (uint32_t r = 0; r < 2 * lanes; r += 8) {
+            for (uint32_t k = 0; k < P; k++) {
+                a[k] = _mm256_loadu_ps(a0 + r + k * sm);
+            }
+            fftMixedDFTAVX2<P>(a, c, sn);
+            _mm256_storeu_ps(y0 + r, a[0]);
+            for (uint32_t j = 1; j < P; j++) {
+                _mm256_storeu_ps(y0 + r + 2 * (size_t)j * s, fftMulAVX2(a[j], tw[j]));
+            }
+        }
+    }
+    if (lanes != s) {
+        fftMixedPassScalar<P>(pass, x, y, 0, lanes);
+    }
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Проходы для оснований 2, 3, 4, 5 и 7, индекс - основание
+ */
+struct FFTMixedKernels {
+    fftMixedPassFunc_t radix[8]{};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+inline FFTMixedKernels fftMixedSelect(void)
+{
+    FFTMixedKernels kernels;
+    kernels.radix[2] = fftMixedPassScalar<2>;
+    kernels.radix[3] = fftMixedPassScalar<3>;
+    kernels.radix[4] = fftMixedPassScalar<4>;
+    kernels.radix[5] = fftMixedPassScalar<5>;
+    kernels.radix[7] = fftMixedPassScalar<7>;
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX2) {
+        kernels.radix[2] = fftMixedPassAVX2<2>;
+        kernels.radix[3] = fftMixedPassAVX2<3>;
+        kernels.radix[4] = fftMixedPassAVX2<4>;
+        kernels.radix[5] = fftMixedPassAVX2<5>;
+        kernels.radix[7] = fftMixedPassAVX2<7>;
+        kernels.level = CpuLevel_AVX2;
+    }
+#endif
+    return kernels;
+}
+
+/**
+ * @brief Проходы, выбранные один раз при первом обращении
+ */
+inline const FFTMixedKernels & fftMixedKernels(void)
+{
+    static const FFTMixedKernels kernels = fftMixedSelect();
+    return kernels;
+}
+
+/**
+ * @brief План FFT произвольного размера
+ *
+ * Разложение размера, поворачивающие множители проходов и (для Bluestein)
+ * спектр чирпа вычисляются в double один раз на размер. План разделяется
+ * всеми рабочими потоками только на чтение, промежуточные данные лежат в
+ * буферах вызывающего потока (workSize()).
+ */
+class FFTMixedPlan {
+public:
+    typedef std::complex<float> complex;
+
+protected:
+    uint32_t length;
+    std::vector<FFTMixedPass> passes;
+    // exp(-j pi k / n), k < n: split step of a 2n-point real transform
+    std::vector<complex> half;
+
+    // Bluestein: chirp exp(-j pi k^2 / n) and FFT of the conjugate chirp filter
+    int bluesteinOrder{-1};
+    std::vector<complex> chirp;
+    std::vector<complex> chirpSpectrum;
+
+    static std::vector<uint32_t> factorize(uint32_t n) {
+        std::vector<uint32_t> radices;
+        while (n % 4 == 0) {
+            radices.push_back(4);
+            n /= 4;
+        }
+        for (uint32_t p : {2u, 3u, 5u, 7u}) {
+            while (n % p == 0) {
+                radices.push_back(p);
+                n /= p;
+            }
+        }
+        if (n != 1) {
+            radices.clear();
+        }
+        // Largest radix first, so that the following strides fill vectors
+        if (!radices.empty()) {
+            std::iter_swap(std::begin(radices), std::max_element(std::begin(radices), std::end(radices)));
+        }
+        return radices;
+    }
+
+    static complex polar(double k, double n) {
+        const std::complex<double> w = std::polar(1.0, -2.0 * M_PI * k / n);
+        return complex(w.real(), w.imag());
+    }
+
+public:
+    explicit FFTMixedPlan(uint32_t n) : length(n) {
+        this->half.resize(n);
+        for (uint32_t k = 0; k < n; k++) {
+            this->half[k] = polar(k, 2.0 * n);
+        }
+
+        const std::vector<uint32_t> radices = factorize(n);
+        if (n > 1 && radices.empty()) {
+            this->buildBluestein();
+            return;
+        }
+
+        uint32_t s = 1;
+        uint32_t len = n;
+        for (uint32_t p : radices) {
+            FFTMixedPass pass;
+            pass.radix = p;
+            pass.m = len / p;
+            pass.s = s;
+            pass.twiddles.resize((size_t)pass.m * (p - 1));
+            for (uint32_t j = 1; j < p; j++) {
+                for (uint32_t q = 0; q < pass.m; q++) {
+                    pass.twiddles[(size_t)(j - 1) * pass.m + q] = polar((double)q * j, len);
+                }
+            }
+            if (p % 2 == 1) {
+                const uint32_t h = (p - 1) / 2;
+                for (uint32_t k = 1; k <= h; k++) {
+                    for (uint32_t j = 1; j <= h; j++) {
+                        const double a = 2.0 * M_PI * (double)((j * k) % p) / (double)p;
+                        pass.cosines.push_back(std::cos(a));
+                        pass.sines.push_back(std::sin(a));
+                    }
+                }
+            }
+            this->passes.push_back(std::move(pass));
+            len /= p;
+            s *= p;
+        }
+    }
+
+    /**
+     * @brief Общий план для размера n, строится при первом запросе
+     */
+    static const FFTMixedPlan & get(uint32_t n) {
+        static std::mutex plansMutex;
+        static std::map<uint32_t, std::unique_ptr<FFTMixedPlan>> plans;
+        std::lock_guard<std::mutex> lock(plansMutex);
+        std::unique_ptr<FFTMixedPlan> & plan = plans[n];
+        if (!plan) {
+            plan.reset(new FFTMixedPlan(n));
+        }
+        return *plan;
+    }
+
+    uint32_t size(void) const {
+        return this->length;
+    }
+
+    bool bluestein(void) const {
+        return this->bluesteinOrder >= 0;
+    }
+
+    /**
+     * @brief Описание разложения для консоли, например "5 * 4 * 2 * 5 * 5"
+     */
+    std::string describe(void) const {
+        if (this->bluestein()) {
+            return "Bluestein over 2^" + std::to_string(this->bluesteinOrder);
+        }
+        std::string text;
+        for (const FFTMixedPass & pass : this->passes) {
+            text += (text.empty() ? "" : " * ") + std::to_string(pass.radix);
+        }
+        return text.empty() ? "1" : text;
+    }
+
+    /**
+     * @brief Множители exp(-j pi k / n), k < n, для fftRealUnpack
+     */
+    const complex * halfTwiddles(void) const {
+        return this->half.data();
+    }
+
+    /**
+     * @brief Размер рабочего буфера transform() в комплексных отсчётах
+     */
+    size_t workSize(void) const {
+        return this->bluestein() ? 2 * (size_t)pow2(this->bluesteinOrder) + fftBatchPad / 2 : 0;
+    }
+
+    /**
+     * @brief Прямое FFT
+     * @param in Отсчёты, используется как рабочий буфер
+     * @param out Результат, не пересекается с in
+     * @param work Рабочий буфер размера workSize()
+     */
+    void transform(complex * in, complex * out, complex * work) const {
+        if (this->bluestein()) {
+            this->transformBluestein(in, out, work);
+            return;
+        }
+        // Passes ping-pong between the buffers and must finish in out
+        complex * src = in;
+        complex * dst = out;
+        if (this->passes.size() % 2 == 0) {
+            std::swap(src, dst);
+            std::copy_n(in, this->length, src);
+        }
+        const FFTMixedKernels & kernels = fftMixedKernels();
+        for (const FFTMixedPass & pass : this->passes) {
+            kernels.radix[pass.radix](pass, reinterpret_cast<const float *>(src), reinterpret_cast<float *>(dst));
+            std::swap(src, dst);
+        }
+    }
+
+protected:
+    void buildBluestein(void) {
+        const uint32_t n = this->length;
+        // 2n - 1 overflows 32 bits from 2^31 points on, so the length is
+        // counted in size_t; the order stops at the largest 32-bit size
+        const size_t required = 2 * (size_t)n - 1;
+        int order = 0;
+        while (order < 31 && ((size_t)1 << order) < required) {
+            order++;
+        }
+        this->bluesteinOrder = order;
+        const uint32_t size = pow2(order);
+
+        this->chirp.resize(n);
+        for (uint32_t k = 0; k < n; k++) {
+            // k^2 mod 2n keeps the phase exact for large k
+            const uint64_t k2 = ((uint64_t)k * k) % (2ULL * n);
+            this->chirp[k] = polar((double)k2, 2.0 * n);
+        }
+
+        std::vector<complex> filter(size, complex(0, 0));
+        filter[0] = std::conj(this->chirp[0]);
+        for (uint32_t k = 1; k < n; k++) {
+            filter[k] = filter[size - k] = std::conj(this->chirp[k]);
+        }
+        // Inverse scaling of the convolution is folded into the filter
+        for (complex & item : filter) {
+            item /= (float)size;
+        }
+        this->chirpSpectrum.resize(size);
+        fastComplexFFT(filter.data(), this->chirpSpectrum.data(), fftPlan_t::get(order));
+    }
+
+    void transformBluestein(const complex * in, complex * out, complex * work) const {
+        const uint32_t n = this->length;
+        const uint32_t size = pow2(this->bluesteinOrder);
+        const fftPlan_t & plan = fftPlan_t::get(this->bluesteinOrder);
+        // Halves are a cache line apart from the power-of-two stride
+        complex * a = work;
+        complex * b = work + size + fftBatchPad / 2;
+        const float * x = reinterpret_cast<const float *>(in);
+        const float * w = reinterpret_cast<const float *>(this->chirp.data());
+        const float * h = reinterpret_cast<const float *>(this->chirpSpectrum.data());
+        float * fa = reinterpret_cast<float *>(a);
+        const float * fb = reinterpret_cast<const float *>(b);
+        float * y = reinterpret_cast<float *>(out);
+
+        for (uint32_t k = 0; k < 2 * n; k += 2) {
+            fa[k] = x[k] * w[k] - x[k + 1] * w[k + 1];
+            fa[k + 1] = x[k] * w[k + 1] + x[k + 1] * w[k];
+        }
+        std::fill(a + n, a + size, complex(0, 0));
+        fastComplexFFT(a, b, plan);
+
+        // Inverse FFT as conj(FFT(conj(.)))
+        for (uint32_t k = 0; k < 2 * size; k += 2) {
+            fa[k] = fb[k] * h[k] - fb[k + 1] * h[k + 1];
+            fa[k + 1] = -(fb[k] * h[k + 1] + fb[k + 1] * h[k]);
+        }
+        fastComplexFFT(a, b, plan);
+
+        for (uint32_t k = 0; k < 2 * n; k += 2) {
+            y[k] = fb[k] * w[k] + fb[k + 1] * w[k + 1];
+            y[k + 1] = fb[k] * w[k + 1] - fb[k + 1] * w[k];
+        }
+    }
+};
+
+// =============================================================================
+
+#endif // FFTMIXED_HPP
@@ -0,0 +1,383 @@
+#ifndef IQCONTAINER_HPP
+#define IQCONTAINER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "dsp.hpp"
+#include "sampleformat.hpp"
+
+// =============================================================================
+// Block-compressed iq16 container (.wfiq)
+// =============================================================================
+//
+// File layout (little-endian):
+//   header   IQContainerHeader
+//   blocks   blocksCount independently decodable blocks
+//   index    blocksCount + 1 uint64_t file offsets (last one is the index start)
+//
+// Every block holds blockSamples iq16_t samples (the last one may be shorter)
+// split into sub-blocks of subblockSamples. Each sub-block stores I and Q
+// separately: one mode byte (bit 7 - delta coding, bits 0..4 - bit width)
+// followed by zigzag values bit-packed LSB first. Delta coding runs from
+// the previous sample of the same block, so a block never depends on others.
+
+static constexpr char iqContainerMagic[8] = {'W', 'F', 'I', 'Q', 'B', 'L', 'K', '1'};
+
+struct IQContainerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t blockSamples;
+    uint32_t subblockSamples;
+    uint64_t totalSamples;
+    uint64_t blocksCount;
+    uint64_t indexOffset;
+};
+
+static inline uint32_t zigzag32(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag32(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline uint32_t bitWidth(uint32_t v) {
+    uint32_t width = 0;
+    while (v != 0) {
+        width++;
+        v >>= 1;
+    }
+    return width;
+}
+
+/**
+ * @brief Верхняя граница размера сжатого блока из count отсчётов, байт
+ */
+inline size_t iqBlockBound(size_t count, size_t subblockSamples)
+{
+    size_t subblocks = (count + subblockSamples - 1) / subblockSamples;
+    // Worst case is 17 bits per zigzag delta plus two mode bytes per sub-block
+    return subblocks * 2 * (2 + (subblockSamples * 17 + 7) / 8);
+}
+
+/**
+ * @brief Сжатие блока отсчётов
+ * @param src Отсчёты блока
+ * @param count Количество отсчётов
+ * @param subblockSamples Размер подблока
+ * @param dst Буфер результата размером не менее iqBlockBound()
+ * @return Размер сжатого блока, байт
+ */
+inline size_t iqBlockEncode(const iq16_t * src, size_t count, size_t subblockSamples, uint8_t * dst)
+{
+    uint8_t * out = dst;
+    int32_t prev[2] = {0, 0};
+    std::vector<uint32_t> raw(subblockSamples);
+    std::vector<uint32_t> delta(subblockSamples);
+
+    for (size_t base = 0; base < count; base += subblockSamples) {
+        const size_t n = std::min(subblockSamples, count - base);
+        for (int ch = 0; ch < 2; ch++) {
+            uint32_t rawMax = 0;
+            uint32_t deltaMax = 0;
+            int32_t last = prev[ch];
+            for (size_t i = 0; i < n; i++) {
+                int32_t value = ch == 0 ? src[base + i].I : src[base + i].Q;
+                raw[i] = zigzag32(value);
+                delta[i] = zigzag32(value - last);
+                rawMax |= raw[i];
+                deltaMax |= delta[i];
+                last = value;
+            }
+            prev[ch] = last;
+
+            const bool useDelta = bitWidth(deltaMax) < bitWidth(rawMax);
+            const uint32_t width = useDelta ? bitWidth(deltaMax) : bitWidth(rawMax);
+            const uint32_t * values = useDelta ? delta.data() : raw.data();
+
+            *out++ = (uint8_t)((useDelta ? 0x80 : 0x00) | width);
+
+            uint64_t acc = 0;
+            uint32_t bits = 0;
+            for (size_t i = 0; i < n; i++) {
+                acc |= (uint64_t)values[i] << bits;
+                bits += width;
+                while (bits >= 8) {
+                    *out++ = (uint8_t)acc;
+                    acc >>= 8;
+                    bits -= 8;
+                }
+            }
+            if (bits > 0) {
+                *out++ = (uint8_t)acc;
+            }
+        }
+    }
+    return out - dst;
+}
+
+/**
+ * @brief Распаковка блока отсчётов
+ * @param src Сжатый блок
+ * @param bytes Размер сжатого блока
+ * @param count Количество отсчётов блока
+ * @param subblockSamples Размер подблока
+ * @param dst Буфер результата на count отсчётов
+ * @return false при повреждённых данных
+ */
+inline bool iqBlockDecode(const uint8_t * src, size_t bytes, size_t count, size_t subblockSamples, iq16_t * dst)
+{
+    const uint8_t * in = src;
+    const uint8_t * end = src + bytes;
+    int32_t prev[2] = {0, 0};
+
+    for (size_t base = 0; base < count; base += subblockSamples) {
+        const size_t n = std::min(subblockSamples, count - base);
+        for (int ch = 0; ch < 2; ch++) {
+            if (in >= end) {
+                return false;
+            }
+            const bool useDelta = (*in & 0x80) != 0;
+            const uint32_t width = *in & 0x1F;
+            in++;
+
+            const size_t packed = (n * width + 7) / 8;
+            if (width > 17 || in + packed > end) {
+                return false;
+            }
+
+            const uint32_t mask = width == 0 ? 0 : (uint32_t)((1ULL << width) - 1);
+            uint64_t acc = 0;
+            uint32_t bits = 0;
+            int32_t last = prev[ch];
+            for (size_t i = 0; i < n; i++) {
+                while (bits < width) {
+                    acc |= (uint64_t)(*in++) << bits;
+                    bits += 8;
+                }
+                int32_t value = unzigzag32((uint32_t)acc & mask);
+                acc >>= width;
+                bits -= width;
+                if (useDelta) {
+                    value += last;
+                }
+                last = value;
+                if (ch == 0) {
+                    dst[base + i].I = (int16_t)value;
+                } else {
+                    dst[base + i].Q = (int16_t)value;
+                }
+            }
+            prev[ch] = last;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Заголовок и индекс блоков контейнера .wfiq
+ *
+ * Читаются только заголовок и индекс, блоки загружаются по требованию.
+ */
+class IQContainer {
+protected:
+    IQContainerHeader header{};
+    std::vector<uint64_t> index;
+
+public:
+    static bool probe(const char * magic) {
+        return std::memcmp(magic, iqContainerMagic, sizeof (iqContainerMagic)) == 0;
+    }
+
+    bool open(const std::string & path) {
+        this->index.clear();
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char *>(&this->header), sizeof (IQContainerHeader))) {
+            return false;
+        }
+        if (!IQContainer::probe(this->header.magic) || this->header.version != 1 || \
+                this->header.format != SampleFormat_CS16 || this->header.blockSamples == 0 || \
+                this->header.subblockSamples == 0) {
+            return false;
+        }
+
+        // The header is checked against the file before anything is
+        // allocated: the index must end the file exactly and the block
+        // count must match the sample count
+        const uint64_t blockSamples = this->header.blockSamples;
+        const uint64_t blocksCount = this->header.blocksCount;
+        // (blocksCount - 1) * blockSamples < totalSamples <= blocksCount * blockSamples,
+        // written without the products that could overflow
+        if (this->header.totalSamples == 0 || \
+                (this->header.totalSamples - 1) / blockSamples + 1 != blocksCount) {
+            return false;
+        }
+        if (!file.seekg(0, std::ios::end)) {
+            return false;
+        }
+        const uint64_t fileSize = (uint64_t)file.tellg();
+        if (this->header.indexOffset < sizeof (IQContainerHeader) || this->header.indexOffset > fileSize || \
+                (fileSize - this->header.indexOffset) / sizeof (uint64_t) != blocksCount + 1 || \
+                (fileSize - this->header.indexOffset) % sizeof (uint64_t) != 0) {
+            return false;
+        }
+
+        this->index.resize(blocksCount + 1);
+        file.seekg(this->header.indexOffset);
+        if (!file.read(reinterpret_cast<char *>(this->index.data()), this->index.size() * sizeof (uint64_t))) {
+            this->index.clear();
+            return false;
+        }
+
+        // Offsets are used unchecked by the streamer and decode(): blocks
+        // must lie between the header and the index, in order, and fit the
+        // buffers sized by compressedBound()
+        const uint64_t blockBound = iqBlockBound(blockSamples, this->header.subblockSamples);
+        bool valid = this->index[0] >= sizeof (IQContainerHeader) && \
+                this->index[blocksCount] == this->header.indexOffset;
+        for (uint64_t block = 0; valid && block < blocksCount; block++) {
+            valid = this->index[block] <= this->index[block + 1] && \
+                    this->index[block + 1] - this->index[block] <= blockBound;
+        }
+        if (!valid) {
+            this->index.clear();
+        }
+        return valid;
+    }
+
+    uint64_t size(void) const {
+        return this->header.totalSamples;
+    }
+
+    size_t blockSamples(void) const {
+        return this->header.blockSamples;
+    }
+
+    size_t subblockSamples(void) const {
+        return this->header.subblockSamples;
+    }
+
+    uint64_t blocksCount(void) const {
+        return this->header.blocksCount;
+    }
+
+    uint64_t blockOffset(uint64_t block) const {
+        return this->index[block];
+    }
+
+    size_t blockSize(uint64_t block) const {
+        return std::min<uint64_t>(this->header.blockSamples, \
+                                  this->header.totalSamples - block * this->header.blockSamples);
+    }
+
+    /**
+     * @brief Размер буфера под сжатые данные count отсчётов с любого смещения
+     */
+    size_t compressedBound(uint64_t count) const {
+        uint64_t blocks = count / this->header.blockSamples + 2;
+        return blocks * iqBlockBound(this->header.blockSamples, this->header.subblockSamples);
+    }
+
+    /**
+     * @brief Распаковка последовательных блоков [first, last)
+     * @param src Сжатые данные, начиная с блока first
+     * @param dst Буфер на (last - first) * blockSamples отсчётов
+     */
+    bool decode(const uint8_t * src, uint64_t first, uint64_t last, iq16_t * dst) const {
+        const uint64_t base = this->index[first];
+        for (uint64_t block = first; block < last; block++) {
+            if (!iqBlockDecode(src + (this->index[block] - base), \
+                               this->index[block + 1] - this->index[block], \
+                               this->blockSize(block), this->header.subblockSamples, \
+                               dst + (block - first) * this->header.blockSamples)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Запись отсчётов iq16_t в контейнер .wfiq
+ *
+ * Блоки независимы и сжимаются параллельно пакетами по числу потоков.
+ * @param src Отсчёты записи
+ * @param count Количество отсчётов
+ * @param path Путь к создаваемому контейнеру
+ * @param stop Флаг досрочной остановки
+ * @return Размер контейнера в байтах либо 0 при ошибке
+ */
+inline uint64_t iqContainerWrite(const iq16_t * src, uint64_t count, const std::string & path, \
+                                 const std::atomic_bool & stop, \
+                                 size_t blockSamples = 65536, size_t subblockSamples = 256)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    IQContainerHeader header{};
+    std::memcpy(header.magic, iqContainerMagic, sizeof (iqContainerMagic));
+    header.version = 1;
+    header.format = SampleFormat_CS16;
+    header.blockSamples = blockSamples;
+    header.subblockSamples = subblockSamples;
+    header.totalSamples = count;
+    header.blocksCount = (count + blockSamples - 1) / blockSamples;
+    file.write(reinterpret_cast<const char *>(&header), sizeof (header));
+
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<uint8_t>> encoded(threads, std::vector<uint8_t>(iqBlockBound(blockSamples, subblockSamples)));
+    std::vector<size_t> encodedSize(threads);
+
+    std::vector<uint64_t> index;
+    index.reserve(header.blocksCount + 1);
+    uint64_t offset = sizeof (header);
+
+    for (uint64_t batch = 0; batch < header.blocksCount; batch += threads) {
+        if (stop.load()) {
+            return 0;
+        }
+        const size_t batchSize = std::min<uint64_t>(threads, header.blocksCount - batch);
+
+        std::vector<std::thread> encoders;
+        for (size_t t = 0; t < batchSize; t++) {
+            encoders.emplace_back([&, t]() {
+                const uint64_t first = (batch + t) * blockSamples;
+                encodedSize[t] = iqBlockEncode(src + first, std::min<uint64_t>(blockSamples, count - first), \
+                                               subblockSamples, encoded[t].data());
+            });
+        }
+        for (std::thread & encoder : encoders) {
+            encoder.join();
+        }
+
+        for (size_t t = 0; t < batchSize; t++) {
+            index.push_back(offset);
+            file.write(reinterpret_cast<const char *>(encoded[t].data()), encodedSize[t]);
+            offset += encodedSize[t];
+        }
+    }
+
+    index.push_back(offset);
+    header.indexOffset = offset;
+    file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof (uint64_t));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof (header));
+
+    return file.good() ? offset + index.size() * sizeof (uint64_t) : 0;
+}
+
+// =============================================================================
+
+#endif // IQCONTAINER_HPP
@@ -0,0 +1,190 @@
+#ifndef IQCONVERT_HPP
+#define IQCONVERT_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+
+#include "dsp.hpp"
+#include "cpudispatch.hpp"
+
+// =============================================================================
+// iq16_t -> complex<float> conversion kernels
+// =============================================================================
+
+/**
+ * @brief Сигнатура ядра преобразования отсчётов iq16_t во float
+ * @param src Отсчёты iq16_t (чередующиеся I/Q)
+ * @param dst Результат, dst[i] = (src[i] - dc) * scale
+ * @param count Количество комплексных отсчётов
+ * @param scale Масштабный множитель
+ * @param dc Постоянная составляющая, вычитаемая из каждого отсчёта
+ * @param window Множители 2 count компонент {re, im} (FFTWindow), nullptr - без окна
+ */
+typedef void (*iqConvertFunc_t)(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                                float scale, std::complex<float> dc, const float * window);
+
+inline void iqConvertScalar(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                            float scale, std::complex<float> dc, const float * window)
+{
+    const float biasI = -dc.real() * scale;
+    const float biasQ = -dc.imag() * scale;
+    for (size_t i = 0; i < count; i++) {
+        float re = src[i].I * scale + biasI;
+        float im = src[i].Q * scale + biasQ;
+        if (window != nullptr) {
+            re *= window[2 * i];
+            im *= window[2 * i + 1];
+        }
+        dst[i] = std::complex<float>(re, im);
+    }
+}
+
+#ifdef IQCONVERT_X86
+// Interleaved I/Q maps 1:1 onto the complex<float> layout, so every kernel
+// treats the data as a flat int16 array and applies a {I, Q} periodic bias.
+// The window table has the same flat layout and is multiplied in the same
+// pass; the branch on it is loop-invariant
+
+__attribute__((target("sse2")))
+inline void iqConvertSSE2(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                          float scale, std::complex<float> dc, const float * window)
+{
+    const int16_t * in = reinterpret_cast<const int16_t *>(src);
+    float * out = reinterpret_cast<float *>(dst);
+    const size_t n = count * 2;
+
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vBias = _mm_setr_ps(-dc.real() * scale, -dc.imag() * scale, \
+                                     -dc.real() * scale, -dc.imag() * scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        // Sign extension of int16 lanes without SSE4.1 pmovsxwd
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        __m128 x0 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), vScale), vBias);
+        __m128 x1 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), vScale), vBias);
+        if (window != nullptr) {
+            x0 = _mm_mul_ps(x0, _mm_loadu_ps(window + i));
+            x1 = _mm_mul_ps(x1, _mm_loadu_ps(window + i + 4));
+        }
+        _mm_storeu_ps(out + i, x0);
+        _mm_storeu_ps(out + i + 4, x1);
+    }
+    iqConvertScalar(src + i / 2, dst + i / 2, count - i / 2, scale, dc, window != nullptr ? window + i : nullptr);
+}
+
+__attribute__((target("avx2,fma")))
+inline void iqConvertAVX2(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                          float scale, std::complex<float> dc, const float * window)
+{
+    const int16_t * in = reinterpret_cast<const int16_t *>(src);
+    float * out = reinterpret_cast<float *>(dst);
+    const size_t n = count * 2;
+
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const float bI = -dc.real() * scale;
+    const float bQ = -dc.imag() * scale;
+    const __m256 vBias = _mm256_setr_ps(bI, bQ, bI, bQ, bI, bQ, bI, bQ);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)));
+        __m256 x0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(lo), vScale, vBias);
+        __m256 x1 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hi), vScale, vBias);
+        if (window != nullptr) {
+            x0 = _mm256_mul_ps(x0, _mm256_loadu_ps(window + i));
+            x1 = _mm256_mul_ps(x1, _mm256_loadu_ps(window + i + 8));
+        }
+        _mm256_storeu_ps(out + i, x0);
+        _mm256_storeu_ps(out + i + 8, x1);
+    }
+    iqConvertScalar(src + i / 2, dst + i / 2, count - i / 2, scale, dc, window != nullptr ? window + i : nullptr);
+}
+
+__attribute__((target("avx512f")))
+inline void iqConvertAVX512(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                            float scale, std::complex<float> dc, const float * window)
+{
+    const int16_t * in = reinterpret_cast<const int16_t *>(src);
+    float * out = reinterpret_cast<float *>(dst);
+    const size_t n = count * 2;
+
+    const __m512 vScale = _mm512_set1_ps(scale);
+    const float bI = -dc.real() * scale;
+    const float bQ = -dc.imag() * scale;
+    const __m512 vBias = _mm512_setr_ps(bI, bQ, bI, bQ, bI, bQ, bI, bQ, \
+                                        bI, bQ, bI, bQ, bI, bQ, bI, bQ);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i lo = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)));
+        __m512i hi = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 16)));
+        __m512 x0 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(lo), vScale, vBias);
+        __m512 x1 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(hi), vScale, vBias);
+        if (window != nullptr) {
+            x0 = _mm512_mul_ps(x0, _mm512_loadu_ps(window + i));
+            x1 = _mm512_mul_ps(x1, _mm512_loadu_ps(window + i + 16));
+        }
+        _mm512_storeu_ps(out + i, x0);
+        _mm512_storeu_ps(out + i + 16, x1);
+    }
+    iqConvertScalar(src + i / 2, dst + i / 2, count - i / 2, scale, dc, window != nullptr ? window + i : nullptr);
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Выбор наиболее широкого ядра не выше cpuLevel()
+ */
+inline CpuKernel<iqConvertFunc_t> iqConvertSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512)
+        return {iqConvertAVX512, CpuLevel_AVX512};
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return {iqConvertAVX2, CpuLevel_AVX2};
+    if (cpuLevel() >= CpuLevel_SSE2)
+        return {iqConvertSSE2, CpuLevel_SSE2};
+#endif
+    return {iqConvertScalar, CpuLevel_Scalar};
+}
+
+inline const CpuKernel<iqConvertFunc_t> & iqConvertKernel(void)
+{
+    static const CpuKernel<iqConvertFunc_t> kernel = iqConvertSelect();
+    return kernel;
+}
+
+/**
+ * @brief Преобразование отсчётов iq16_t во float с вычитанием постоянной
+ * составляющей, масштабированием и окном за один проход
+ *
+ * Ядро выбирается один раз при первом вызове.
+ */
+inline void iqConvert(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                      float scale = 1.0f, std::complex<float> dc = {0, 0}, \
+                      const float * window = nullptr)
+{
+    iqConvertKernel().func(src, dst, count, scale, dc, window);
+}
+
+/**
+ * @brief Оценка постоянной составляющей как среднего по отсчётам
+ */
+inline std::complex<float> iqMean(const iq16_t * src, size_t count)
+{
+    if (count == 0) {
+        return {0, 0};
+    }
+    int64_t sumI = 0;
+    int64_t sumQ = 0;
+    for (size_t i = 0; i < count; i++) {
+        sumI += src[i].I;
+        sumQ += src[i].Q;
+    }
+    return std::complex<float>((double)sumI / count, (double)sumQ / count);
+}
+
+// =============================================================================
+
+#endif // IQCONVERT_HPP
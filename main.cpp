@@ -6,6 +6,9 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // Identifies the QSettings storage
+    QApplication::setOrganizationName("MADMechaniculus");
+    QApplication::setApplicationName("waterfall");
 
     QFile file(":/dark-green/stylesheet.qss");
     file.open(QFile::ReadOnly | QFile::Text);
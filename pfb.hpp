@@ -0,0 +1,116 @@
+#ifndef PFB_HPP
+#define PFB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "cpudispatch.hpp"
+
+// =============================================================================
+// Polyphase filter bank front end
+// =============================================================================
+//
+// A row of n channels is computed from taps * n consecutive samples: they
+// are weighted by the prototype filter (FFTWindow with taps > 1) and the
+// taps blocks of n are summed, after which the ordinary n-point FFT of the
+// sum gives the channel outputs. Each bin then has the response of the
+// prototype, one bin wide with steep skirts, instead of the sinc of a
+// single transform, so a strong channel no longer leaks into its
+// neighbours. With the row step equal to n the bank is critically sampled.
+//
+// The front end is one multiply-add per input component on top of the
+// conversion, taps * 2 n flops against the 5 n log2 n of the transform.
+// Components are folded as plain floats: for complex rows the table holds
+// {h, h} pairs, for real records consecutive real taps, as in FFTWindow.
+
+/**
+ * @brief Сигнатура ядра свёртки: out[c] = sum x[c + t count] h[c + t count], t < taps
+ */
+typedef void (*pfbFoldFunc_t)(const float * x, const float * h, size_t taps, size_t count, float * out);
+
+inline void pfbFoldScalar(const float * x, const float * h, size_t taps, size_t count, float * out)
+{
+    for (size_t c = 0; c < count; c++) {
+        float acc = x[c] * h[c];
+        for (size_t t = 1; t < taps; t++) {
+            acc += x[c + t * count] * h[c + t * count];
+        }
+        out[c] = acc;
+    }
+}
+
+#ifdef IQCONVERT_X86
+__attribute__((target("sse2")))
+inline void pfbFoldSSE2(const float * x, const float * h, size_t taps, size_t count, float * out)
+{
+    size_t c = 0;
+    for (; c + 4 <= count; c += 4) {
+        __m128 acc = _mm_mul_ps(_mm_loadu_ps(x + c), _mm_loadu_ps(h + c));
+        for (size_t t = 1; t < taps; t++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + c + t * count), _mm_loadu_ps(h + c + t * count)));
+        }
+        _mm_storeu_ps(out + c, acc);
+    }
+    pfbFoldScalar(x + c, h + c, taps, count - c, out + c);
+}
+
+__attribute__((target("avx2,fma")))
+inline void pfbFoldAVX2(const float * x, const float * h, size_t taps, size_t count, float * out)
+{
+    size_t c = 0;
+    for (; c + 8 <= count; c += 8) {
+        __m256 acc = _mm256_mul_ps(_mm256_loadu_ps(x + c), _mm256_loadu_ps(h + c));
+        for (size_t t = 1; t < taps; t++) {
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(x + c + t * count), _mm256_loadu_ps(h + c + t * count), acc);
+        }
+        _mm256_storeu_ps(out + c, acc);
+    }
+    pfbFoldScalar(x + c, h + c, taps, count - c, out + c);
+}
+
+__attribute__((target("avx512f")))
+inline void pfbFoldAVX512(const float * x, const float * h, size_t taps, size_t count, float * out)
+{
+    size_t c = 0;
+    for (; c + 16 <= count; c += 16) {
+        __m512 acc = _mm512_mul_ps(_mm512_loadu_ps(x + c), _mm512_loadu_ps(h + c));
+        for (size_t t = 1; t < taps; t++) {
+            acc = _mm512_fmadd_ps(_mm512_loadu_ps(x + c + t * count), _mm512_loadu_ps(h + c + t * count), acc);
+        }
+        _mm512_storeu_ps(out + c, acc);
+    }
+    pfbFoldScalar(x + c, h + c, taps, count - c, out + c);
+}
+#endif
+
+inline CpuKernel<pfbFoldFunc_t> pfbFoldSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512)
+        return {pfbFoldAVX512, CpuLevel_AVX512};
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return {pfbFoldAVX2, CpuLevel_AVX2};
+    if (cpuLevel() >= CpuLevel_SSE2)
+        return {pfbFoldSSE2, CpuLevel_SSE2};
+#endif
+    return {pfbFoldScalar, CpuLevel_Scalar};
+}
+
+inline const CpuKernel<pfbFoldFunc_t> & pfbFoldKernel(void)
+{
+    static const CpuKernel<pfbFoldFunc_t> kernel = pfbFoldSelect();
+    return kernel;
+}
+
+/**
+ * @brief Свёртка taps строк по count компонент с прототипом в одну строку
+ */
+inline void pfbFold(const float * x, const float * h, size_t taps, size_t count, float * out)
+{
+    pfbFoldKernel().func(x, h, taps, count, out);
+}
+
+// =============================================================================
+
+#endif // PFB_HPP
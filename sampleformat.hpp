@@ -0,0 +1,205 @@
+#ifndef SAMPLEFORMAT_HPP
+#define SAMPLEFORMAT_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <cctype>
+
+#include "dsp.hpp"
+#include "iqconvert.hpp"
+
+// =============================================================================
+// Record sample formats
+// =============================================================================
+
+enum SampleFormat : uint16_t {
+    SampleFormat_CS8 = 0,
+    SampleFormat_CU8,
+    SampleFormat_CS16,
+    SampleFormat_CS16BE,
+    SampleFormat_CF32,
+    SampleFormat_CF64,
+    SampleFormat_RS16
+};
+
+/**
+ * @brief Размер одного комплексного отсчёта формата в байтах
+ *
+ * Вещественные записи (SampleFormat_RS16) обрабатываются парами соседних
+ * отсчётов (r16pair_t), так что отсчётом здесь и далее считается пара.
+ */
+inline size_t sampleFormatSize(SampleFormat format)
+{
+    switch (format) {
+    case SampleFormat_CS8:
+        return sizeof (iq8_t);
+    case SampleFormat_CU8:
+        return sizeof (iqu8_t);
+    case SampleFormat_CS16BE:
+        return sizeof (iq16be_t);
+    case SampleFormat_CF32:
+        return sizeof (std::complex<float>);
+    case SampleFormat_CF64:
+        return sizeof (std::complex<double>);
+    case SampleFormat_RS16:
+        return sizeof (r16pair_t);
+    case SampleFormat_CS16:
+    default:
+        return sizeof (iq16_t);
+    }
+}
+
+inline const char * sampleFormatName(SampleFormat format)
+{
+    switch (format) {
+    case SampleFormat_CS8:
+        return "cs8";
+    case SampleFormat_CU8:
+        return "cu8";
+    case SampleFormat_CS16BE:
+        return "cs16 BE";
+    case SampleFormat_CF32:
+        return "cf32";
+    case SampleFormat_CF64:
+        return "cf64";
+    case SampleFormat_RS16:
+        return "rs16 (real)";
+    case SampleFormat_CS16:
+    default:
+        return "cs16";
+    }
+}
+
+/**
+ * @brief Определение формата отсчётов по расширению файла
+ * @param suffix Расширение файла без точки
+ * @return Формат; неизвестные расширения считаются cs16 (iq16_t)
+ */
+inline SampleFormat sampleFormatFromExtension(std::string suffix)
+{
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](unsigned char c) {
+        return (char)std::tolower(c);
+    });
+
+    if (suffix == "cs8" || suffix == "s8" || suffix == "iq8")
+        return SampleFormat_CS8;
+    if (suffix == "cu8" || suffix == "u8")
+        return SampleFormat_CU8;
+    if (suffix == "cs16be" || suffix == "s16be")
+        return SampleFormat_CS16BE;
+    if (suffix == "cf32" || suffix == "fc32" || suffix == "cfile")
+        return SampleFormat_CF32;
+    if (suffix == "cf64" || suffix == "fc64")
+        return SampleFormat_CF64;
+    if (suffix == "rs16" || suffix == "r16")
+        return SampleFormat_RS16;
+    return SampleFormat_CS16;
+}
+
+/**
+ * @brief Запись из вещественных отсчётов: вместо полного спектра
+ * отображается неизбыточная половина [0, Fs / 2)
+ */
+inline bool sampleFormatIsReal(SampleFormat format)
+{
+    return format == SampleFormat_RS16;
+}
+
+/**
+ * @brief Вызов обобщённого функтора с типом отсчёта, соответствующим формату
+ *
+ * Ветвление по формату выполняется один раз на вызов: функтор получает
+ * значение-метку нужного типа и инстанцируется отдельно для каждого
+ * формата, поэтому внутренние циклы по отсчётам не содержат ни
+ * виртуальных вызовов, ни проверок формата.
+ */
+template<class Func_T>
+inline void dispatchSampleFormat(SampleFormat format, Func_T && func)
+{
+    switch (format) {
+    case SampleFormat_CS8:
+        func(iq8_t());
+        break;
+    case SampleFormat_CU8:
+        func(iqu8_t());
+        break;
+    case SampleFormat_CS16BE:
+        func(iq16be_t());
+        break;
+    case SampleFormat_CF32:
+        func(std::complex<float>());
+        break;
+    case SampleFormat_CF64:
+        func(std::complex<double>());
+        break;
+    case SampleFormat_RS16:
+        func(r16pair_t());
+        break;
+    case SampleFormat_CS16:
+    default:
+        func(iq16_t());
+        break;
+    }
+}
+
+/**
+ * @brief Преобразование отсчётов во float с вычитанием постоянной
+ * составляющей; для iq16_t используется векторное ядро iqConvert
+ * @param window Множители 2 count компонент {re, im} (FFTWindow), nullptr - без окна
+ */
+template<class Sample_T>
+inline void sampleConvert(const Sample_T * src, std::complex<float> * dst, size_t count, \
+                          float scale, std::complex<float> dc, const float * window = nullptr)
+{
+    for (size_t i = 0; i < count; i++) {
+        std::complex<float> x = (toComplex<std::complex<float>>(src[i]) - dc) * scale;
+        if (window != nullptr) {
+            x = std::complex<float>(x.real() * window[2 * i], x.imag() * window[2 * i + 1]);
+        }
+        dst[i] = x;
+    }
+}
+
+template<>
+inline void sampleConvert<iq16_t>(const iq16_t * src, std::complex<float> * dst, size_t count, \
+                                  float scale, std::complex<float> dc, const float * window)
+{
+    iqConvert(src, dst, count, scale, dc, window);
+}
+
+template<>
+inline void sampleConvert<r16pair_t>(const r16pair_t * src, std::complex<float> * dst, size_t count, \
+                                     float scale, std::complex<float> dc, const float * window)
+{
+    // Same layout as iq16_t: even samples in I, odd samples in Q
+    iqConvert(reinterpret_cast<const iq16_t *>(src), dst, count, scale, dc, window);
+}
+
+/**
+ * @brief Оценка постоянной составляющей как среднего по отсчётам
+ */
+template<class Sample_T>
+inline std::complex<float> sampleMean(const Sample_T * src, size_t count)
+{
+    if (count == 0) {
+        return {0, 0};
+    }
+    std::complex<double> sum(0, 0);
+    for (size_t i = 0; i < count; i++) {
+        sum += toComplex<std::complex<double>>(src[i]);
+    }
+    return std::complex<float>(sum / (double)count);
+}
+
+template<>
+inline std::complex<float> sampleMean<iq16_t>(const iq16_t * src, size_t count)
+{
+    return iqMean(src, count);
+}
+
+// =============================================================================
+
+#endif // SAMPLEFORMAT_HPP
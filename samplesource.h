@@ -0,0 +1,186 @@
+#ifndef SAMPLESOURCE_H
+#define SAMPLESOURCE_H
+
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <mutex>
+
+#ifdef __unix__
+#include <sys/mman.h>
+#endif
+
+#include "dsp.hpp"
+#include "sampleformat.hpp"
+#include "iqcontainer.hpp"
+
+/**
+ * @brief Источник отсчётов записи, отображённый в память (mmap)
+ *
+ * Файл не читается и не копируется: рабочие потоки ColorMapWorker
+ * обращаются к отсчётам напрямую по указателю на отображение и
+ * интерпретируют их согласно формату записи (SampleFormat),
+ * страницы подгружаются ядром по мере обращения. Размер записи
+ * ограничен только адресным пространством процесса.
+ *
+ * В потоковом режиме файл целиком не отображается: ChunkStreamer
+ * отображает и освобождает отдельные участки (mapRegion/unmapRegion),
+ * так что объём памяти не зависит от размера записи.
+ *
+ * Сжатые контейнеры .wfiq распознаются по сигнатуре и не отображаются:
+ * доступны только заголовок и индекс блоков (container()), блоки
+ * читает и распаковывает ChunkStreamer в режиме ChunkStreamer_Mode_Container.
+ */
+class SampleSource {
+protected:
+    QFile file;
+    uchar * mapping{nullptr};
+    uint64_t samplesCount{0};
+
+    SampleFormat sampleFormat{SampleFormat_CS16};
+    size_t sampleSize{sizeof (iq16_t)};
+
+    IQContainer blockContainer;
+    bool compressed{false};
+
+    std::mutex regionMutex;
+
+public:
+    SampleSource() {}
+    SampleSource(const SampleSource &) = delete;
+    SampleSource & operator=(const SampleSource &) = delete;
+
+    ~SampleSource() {
+        this->close();
+    }
+
+    /**
+     * @brief Открытие и отображение файла записи в память
+     * @param path Путь к файлу записи
+     * @param format Формат отсчётов записи
+     * @param mapAll Отображать файл целиком (false - только участками)
+     * @return true при успешном открытии
+     */
+    bool open(const QString & path, SampleFormat format, bool mapAll = true) {
+        this->close();
+
+        this->sampleFormat = format;
+        this->sampleSize = sampleFormatSize(format);
+
+        this->file.setFileName(path);
+        if (!this->file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        char magic[sizeof (iqContainerMagic)];
+        if (this->file.peek(magic, sizeof (magic)) == sizeof (magic) && IQContainer::probe(magic)) {
+            if (!this->blockContainer.open(QFile::encodeName(path).toStdString()) || \
+                    this->blockContainer.size() == 0) {
+                this->file.close();
+                return false;
+            }
+            this->compressed = true;
+            this->sampleFormat = SampleFormat_CS16;
+            this->sampleSize = sizeof (iq16_t);
+            this->samplesCount = this->blockContainer.size();
+            return true;
+        }
+
+        uint64_t count = this->file.size() / this->sampleSize;
+        if (count == 0) {
+            this->file.close();
+            return false;
+        }
+        this->samplesCount = count;
+
+        if (!mapAll) {
+            return true;
+        }
+
+        this->mapping = this->file.map(0, count * this->sampleSize);
+        if (this->mapping == nullptr) {
+            this->file.close();
+            this->samplesCount = 0;
+            return false;
+        }
+
+#ifdef __unix__
+        // Rows are walked mostly front to back, let the kernel read ahead
+        madvise(this->mapping, count * this->sampleSize, MADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    void close(void) {
+        if (this->mapping != nullptr) {
+            this->file.unmap(this->mapping);
+            this->mapping = nullptr;
+        }
+        if (this->file.isOpen()) {
+            this->file.close();
+        }
+        this->samplesCount = 0;
+        this->compressed = false;
+    }
+
+    /**
+     * @brief Отображение участка записи в память
+     * @param first Индекс первого отсчёта участка
+     * @param count Количество отсчётов
+     * @return Указатель на первый отсчёт либо nullptr при ошибке
+     * (в том числе для сжатого контейнера)
+     */
+    const uchar * mapRegion(uint64_t first, uint64_t count) {
+        if (this->compressed) {
+            return nullptr;
+        }
+        if (this->mapping != nullptr) {
+            return this->data() + first * this->sampleSize;
+        }
+        std::lock_guard<std::mutex> lock(this->regionMutex);
+        return this->file.map(first * this->sampleSize, count * this->sampleSize);
+    }
+
+    void unmapRegion(const uchar * region) {
+        if (this->mapping != nullptr || region == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(this->regionMutex);
+        this->file.unmap(const_cast<uchar *>(region));
+    }
+
+    bool isOpen(void) const {
+        return this->file.isOpen();
+    }
+
+    bool isCompressed(void) const {
+        return this->compressed;
+    }
+
+    const IQContainer & container(void) const {
+        return this->blockContainer;
+    }
+
+    bool isMapped(void) const {
+        return this->mapping != nullptr;
+    }
+
+    const uchar * data(void) const {
+        return this->mapping;
+    }
+
+    SampleFormat format(void) const {
+        return this->sampleFormat;
+    }
+
+    uint64_t size(void) const {
+        return this->samplesCount;
+    }
+
+    QString fileName(void) const {
+        return this->file.fileName();
+    }
+};
+
+#endif // SAMPLESOURCE_H
@@ -0,0 +1,233 @@
+#ifndef SIGMF_H
+#define SIGMF_H
+
+#include <QString>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "sampleformat.hpp"
+
+/**
+ * @brief Сегмент записи SigMF (core:captures)
+ */
+struct SigMFCapture {
+    uint64_t sampleStart{0};
+    double frequency{NAN};
+};
+
+/**
+ * @brief Аннотация записи SigMF (core:annotations)
+ */
+struct SigMFAnnotation {
+    uint64_t sampleStart{0};
+    uint64_t sampleCount{0};
+    double freqLower{NAN};
+    double freqUpper{NAN};
+    QString label;
+};
+
+/**
+ * @brief Метаданные записи SigMF (.sigmf-meta)
+ *
+ * Разбирается только JSON-файл метаданных, файл данных открывается через
+ * SampleSource и не читается дополнительно. Аннотации упорядочены по
+ * начальному отсчёту и снабжены префиксным максимумом конечного отсчёта,
+ * поэтому выборка аннотаций для диапазона строк выполняется двоичным
+ * поиском без перебора всего списка.
+ */
+class SigMFMeta {
+protected:
+    std::vector<uint64_t> annotationsEnd;
+
+    static bool parseDatatype(const QString & datatype, SampleFormat & format) {
+        if (datatype == "ci8" || datatype == "ci8_le" || datatype == "ci8_be")
+            format = SampleFormat_CS8;
+        else if (datatype == "cu8" || datatype == "cu8_le" || datatype == "cu8_be")
+            format = SampleFormat_CU8;
+        else if (datatype == "ci16_le")
+            format = SampleFormat_CS16;
+        else if (datatype == "ci16_be")
+            format = SampleFormat_CS16BE;
+        else if (datatype == "cf32_le")
+            format = SampleFormat_CF32;
+        else if (datatype == "cf64_le")
+            format = SampleFormat_CF64;
+        else
+            return false;
+        return true;
+    }
+
+public:
+    SampleFormat format{SampleFormat_CS16};
+    double sampleRate{NAN};
+    std::vector<SigMFCapture> captures;
+    std::vector<SigMFAnnotation> annotations;
+
+    static bool isSigMF(const QString & path) {
+        return path.endsWith(".sigmf-meta") || path.endsWith(".sigmf-data");
+    }
+
+    static QString metaPath(const QString & path) {
+        return path.left(path.lastIndexOf('.')) + ".sigmf-meta";
+    }
+
+    static QString dataPath(const QString & path) {
+        return path.left(path.lastIndexOf('.')) + ".sigmf-data";
+    }
+
+    /**
+     * @brief Загрузка метаданных из файла .sigmf-meta
+     * @param path Путь к файлу метаданных либо данных записи
+     * @param error Описание ошибки при неудаче
+     * @return true при успешном разборе
+     */
+    bool load(const QString & path, QString & error) {
+        *this = SigMFMeta();
+
+        QFile metaFile(SigMFMeta::metaPath(path));
+        if (!metaFile.open(QIODevice::ReadOnly)) {
+            error = "Error on opening SigMF metadata";
+            return false;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(metaFile.readAll(), &parseError);
+        if (document.isNull() || !document.isObject()) {
+            error = "SigMF metadata parse error: " + parseError.errorString();
+            return false;
+        }
+
+        QJsonObject root = document.object();
+        QJsonObject global = root.value("global").toObject();
+
+        QString datatype = global.value("core:datatype").toString();
+        if (!SigMFMeta::parseDatatype(datatype, this->format)) {
+            error = "Unsupported SigMF datatype: " + datatype;
+            return false;
+        }
+
+        if (global.contains("core:sample_rate")) {
+            this->sampleRate = global.value("core:sample_rate").toDouble();
+        }
+
+        for (const QJsonValue & item : root.value("captures").toArray()) {
+            QJsonObject capture = item.toObject();
+            SigMFCapture segment;
+            segment.sampleStart = (uint64_t)capture.value("core:sample_start").toDouble();
+            if (capture.contains("core:frequency")) {
+                segment.frequency = capture.value("core:frequency").toDouble();
+            }
+            this->captures.push_back(segment);
+        }
+        std::sort(this->captures.begin(), this->captures.end(), \
+                  [](const SigMFCapture & a, const SigMFCapture & b) {
+            return a.sampleStart < b.sampleStart;
+        });
+
+        for (const QJsonValue & item : root.value("annotations").toArray()) {
+            QJsonObject annotation = item.toObject();
+            SigMFAnnotation mark;
+            mark.sampleStart = (uint64_t)annotation.value("core:sample_start").toDouble();
+            mark.sampleCount = (uint64_t)annotation.value("core:sample_count").toDouble();
+            if (annotation.contains("core:freq_lower_edge")) {
+                mark.freqLower = annotation.value("core:freq_lower_edge").toDouble();
+            }
+            if (annotation.contains("core:freq_upper_edge")) {
+                mark.freqUpper = annotation.value("core:freq_upper_edge").toDouble();
+            }
+            mark.label = annotation.value("core:label").toString();
+            this->annotations.push_back(mark);
+        }
+        std::sort(this->annotations.begin(), this->annotations.end(), \
+                  [](const SigMFAnnotation & a, const SigMFAnnotation & b) {
+            return a.sampleStart < b.sampleStart;
+        });
+
+        uint64_t maxEnd = 0;
+        this->annotationsEnd.resize(this->annotations.size());
+        for (size_t i = 0; i < this->annotations.size(); i++) {
+            maxEnd = std::max(maxEnd, this->annotations[i].sampleStart + this->annotations[i].sampleCount);
+            this->annotationsEnd[i] = maxEnd;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Запись метаданных для файла данных записи
+     * @param path Путь к файлу метаданных либо данных записи
+     * @param datatype Тип отсчётов SigMF (core:datatype)
+     * @param frequency Центральная частота, NAN - не записывается
+     * @return true при успешной записи
+     */
+    static bool save(const QString & path, const QString & datatype, double sampleRate, double frequency, \
+                     const QString & description) {
+        QJsonObject global;
+        global.insert("core:datatype", datatype);
+        global.insert("core:sample_rate", sampleRate);
+        global.insert("core:version", "1.0.0");
+        if (!description.isEmpty()) {
+            global.insert("core:description", description);
+        }
+
+        QJsonObject capture;
+        capture.insert("core:sample_start", 0);
+        if (!std::isnan(frequency)) {
+            capture.insert("core:frequency", frequency);
+        }
+
+        QJsonObject root;
+        root.insert("global", global);
+        root.insert("captures", QJsonArray{capture});
+        root.insert("annotations", QJsonArray());
+
+        QFile metaFile(SigMFMeta::metaPath(path));
+        if (!metaFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+        return metaFile.write(QJsonDocument(root).toJson()) > 0;
+    }
+
+    /**
+     * @brief Центральная частота сегмента, содержащего отсчёт
+     * @return NAN, если частота в метаданных не указана
+     */
+    double frequencyAt(uint64_t sample) const {
+        auto it = std::upper_bound(this->captures.begin(), this->captures.end(), sample, \
+                                   [](uint64_t value, const SigMFCapture & capture) {
+            return value < capture.sampleStart;
+        });
+        if (it == this->captures.begin()) {
+            return this->captures.empty() ? NAN : this->captures.front().frequency;
+        }
+        return (it - 1)->frequency;
+    }
+
+    /**
+     * @brief Выборка аннотаций, пересекающихся с диапазоном отсчётов
+     * @param first Первый отсчёт диапазона
+     * @param last Отсчёт, следующий за последним отсчётом диапазона
+     * @return Индексы аннотаций в векторе annotations
+     */
+    std::vector<size_t> annotationsInRange(uint64_t first, uint64_t last) const {
+        std::vector<size_t> result;
+        // Prefix maximum of annotation ends is monotonic, skip everything ending before first
+        size_t i = std::upper_bound(this->annotationsEnd.begin(), this->annotationsEnd.end(), first) - \
+                this->annotationsEnd.begin();
+        for (; i < this->annotations.size() && this->annotations[i].sampleStart < last; i++) {
+            if (this->annotations[i].sampleStart + this->annotations[i].sampleCount > first) {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+};
+
+#endif // SIGMF_H
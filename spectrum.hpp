@@ -0,0 +1,539 @@
+#ifndef SPECTRUM_HPP
+#define SPECTRUM_HPP
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "cpudispatch.hpp"
+
+// =============================================================================
+// Spectrum rows of the waterfall
+// =============================================================================
+//
+// One pass over the FFT output writes the row as contiguous floats and
+// returns its maximum. Interleaved {re, im} pairs are split into re and im
+// vectors by shuffles, after which the row is |X| (one sqrt), |X|^2 (no sqrt
+// at all) or 10 lg |X|^2. The decibel scale uses a polynomial log2 on the
+// float bits instead of a library log: exponent plus t * P(t) over the
+// mantissa 1 + t, with a degree 5 minimax P, error below 2e-5 in log2, that
+// is below 1e-4 dB. Powers are floored at spectrumPowerFloor, so empty bins
+// give -300 dB rather than -inf and denormals never reach the log.
+// The running maximum is the second operand of maxps, so NaN bins are
+// skipped as in the scalar comparison.
+//
+// Rows reduced over several transforms fold |X|^2 of every transform into a
+// float row with the same shuffles: a sum for the mean (Welch), maxps or
+// minps for the holds, which keep a short pulse that the mean dilutes. The
+// row is written once from the reduced power. The held value is the second
+// operand of maxps and minps, so NaN bins are skipped here as well.
+
+enum SpectrumScale {
+    // |X|
+    SpectrumScale_Magnitude = 0,
+    // |X|^2
+    SpectrumScale_Power,
+    // 10 lg |X|^2
+    SpectrumScale_Decibel
+};
+
+enum SpectrumReduce {
+    // Mean power, Welch averaging
+    SpectrumReduce_Mean = 0,
+    SpectrumReduce_MaxHold,
+    SpectrumReduce_MinHold
+};
+
+inline const char * spectrumReduceName(SpectrumReduce reduce)
+{
+    switch (reduce) {
+    case SpectrumReduce_MaxHold: return "max hold";
+    case SpectrumReduce_MinHold: return "min hold";
+    default: return "mean";
+    }
+}
+
+/**
+ * @brief Начальное значение строки для свёртки reduce
+ */
+inline float spectrumReduceInit(SpectrumReduce reduce)
+{
+    return reduce == SpectrumReduce_MinHold ? std::numeric_limits<float>::infinity() : 0.0f;
+}
+
+inline const char * spectrumScaleName(SpectrumScale scale)
+{
+    switch (scale) {
+    case SpectrumScale_Power: return "power";
+    case SpectrumScale_Decibel: return "dB";
+    default: return "magnitude";
+    }
+}
+
+constexpr float spectrumPowerFloor = 1e-30f;
+// 10 lg 2, dB per octave of power
+constexpr float spectrumDecibelScale = 3.01029995664f;
+
+// log2(1 + t) = t * P(t), t in [0, 1)
+constexpr float spectrumLog2C1 = 1.441879896f;
+constexpr float spectrumLog2C2 = -0.708865218f;
+constexpr float spectrumLog2C3 = 0.415245560f;
+constexpr float spectrumLog2C4 = -0.193516525f;
+constexpr float spectrumLog2C5 = 0.045268293f;
+
+/**
+ * @brief Сигнатура ядра строки спектра
+ * @param x Бины спектра
+ * @param out Значения строки в выбранной шкале, n значений
+ * @param n Количество бинов
+ * @return Максимальное значение строки, -inf для пустой строки
+ */
+typedef float (*spectrumRowFunc_t)(const std::complex<float> * x, float * out, size_t n);
+
+/**
+ * @brief Быстрый log2 положительного нормализованного числа
+ */
+inline float spectrumLog2(float v)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    const float e = (float)((int32_t)(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    const float t = m - 1.0f;
+    const float poly = spectrumLog2C1 + t * (spectrumLog2C2 + t * (spectrumLog2C3 + \
+                       t * (spectrumLog2C4 + t * spectrumLog2C5)));
+    return e + t * poly;
+}
+
+/**
+ * @brief Сигнатура ядра свёртки мощности: acc[i] = reduce(acc[i], |x[i]|^2)
+ */
+typedef void (*spectrumAccumulateFunc_t)(const std::complex<float> * x, float * acc, size_t n);
+
+/**
+ * @brief Сигнатура ядра строки из накопленной мощности
+ * @param power Накопленная мощность, n значений
+ * @param gain Множитель мощности (1 / количество усреднённых спектров)
+ * @param out Значения строки в выбранной шкале
+ * @return Максимальное значение строки, -inf для пустой строки
+ */
+typedef float (*spectrumPowerFunc_t)(const float * power, float gain, float * out, size_t n);
+
+/**
+ * @brief Мощность в шкале Scale
+ */
+template<SpectrumScale Scale>
+inline float spectrumScaled(float power)
+{
+    if constexpr (Scale == SpectrumScale_Magnitude) {
+        return std::sqrt(power);
+    } else if constexpr (Scale == SpectrumScale_Power) {
+        return power;
+    } else {
+        // Floor first, so NaN is replaced by the floor as in maxps
+        return spectrumDecibelScale * spectrumLog2(std::max(spectrumPowerFloor, power));
+    }
+}
+
+template<SpectrumScale Scale>
+inline float spectrumRowScalar(const std::complex<float> * x, float * out, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    float maxValue = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = spectrumScaled<Scale>(p[2 * i] * p[2 * i] + p[2 * i + 1] * p[2 * i + 1]);
+        maxValue = std::max(maxValue, out[i]);
+    }
+    return maxValue;
+}
+
+template<SpectrumReduce Reduce>
+inline void spectrumAccumulateScalar(const std::complex<float> * x, float * acc, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    for (size_t i = 0; i < n; i++) {
+        const float power = p[2 * i] * p[2 * i] + p[2 * i + 1] * p[2 * i + 1];
+        if constexpr (Reduce == SpectrumReduce_MaxHold) {
+            acc[i] = power > acc[i] ? power : acc[i];
+        } else if constexpr (Reduce == SpectrumReduce_MinHold) {
+            acc[i] = power < acc[i] ? power : acc[i];
+        } else {
+            acc[i] += power;
+        }
+    }
+}
+
+template<SpectrumScale Scale>
+inline float spectrumPowerScalar(const float * power, float gain, float * out, size_t n)
+{
+    float maxValue = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = spectrumScaled<Scale>(power[i] * gain);
+        maxValue = std::max(maxValue, out[i]);
+    }
+    return maxValue;
+}
+
+#ifdef IQCONVERT_X86
+__attribute__((target("sse2")))
+inline __m128 spectrumLog2SSE2(__m128 v)
+{
+    const __m128i bits = _mm_castps_si128(v);
+    const __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    const __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), \
+                                                   _mm_set1_epi32(0x3F800000)));
+    const __m128 t = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+    __m128 poly = _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(spectrumLog2C5)), _mm_set1_ps(spectrumLog2C4));
+    poly = _mm_add_ps(_mm_mul_ps(t, poly), _mm_set1_ps(spectrumLog2C3));
+    poly = _mm_add_ps(_mm_mul_ps(t, poly), _mm_set1_ps(spectrumLog2C2));
+    poly = _mm_add_ps(_mm_mul_ps(t, poly), _mm_set1_ps(spectrumLog2C1));
+    return _mm_add_ps(e, _mm_mul_ps(t, poly));
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("sse2")))
+inline __m128 spectrumScaledSSE2(__m128 v)
+{
+    if constexpr (Scale == SpectrumScale_Magnitude) {
+        return _mm_sqrt_ps(v);
+    } else if constexpr (Scale == SpectrumScale_Power) {
+        return v;
+    } else {
+        return _mm_mul_ps(spectrumLog2SSE2(_mm_max_ps(v, _mm_set1_ps(spectrumPowerFloor))), \
+                          _mm_set1_ps(spectrumDecibelScale));
+    }
+}
+
+__attribute__((target("sse2")))
+inline float spectrumMaxSSE2(__m128 vmax)
+{
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vmax);
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+/**
+ * @brief |x|^2 четырёх бинов: {re, im} разделяются перестановками
+ */
+__attribute__((target("sse2")))
+inline __m128 spectrumPowerSSE2(const float * p)
+{
+    const __m128 a = _mm_loadu_ps(p);
+    const __m128 b = _mm_loadu_ps(p + 4);
+    const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("sse2")))
+inline float spectrumRowSSE2(const std::complex<float> * x, float * out, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    __m128 vmax = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = spectrumScaledSSE2<Scale>(spectrumPowerSSE2(p + 2 * i));
+        _mm_storeu_ps(out + i, v);
+        vmax = _mm_max_ps(v, vmax);
+    }
+    return std::max(spectrumMaxSSE2(vmax), spectrumRowScalar<Scale>(x + i, out + i, n - i));
+}
+
+template<SpectrumReduce Reduce>
+__attribute__((target("sse2")))
+inline void spectrumAccumulateSSE2(const std::complex<float> * x, float * acc, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 power = spectrumPowerSSE2(p + 2 * i);
+        const __m128 held = _mm_loadu_ps(acc + i);
+        if constexpr (Reduce == SpectrumReduce_MaxHold) {
+            _mm_storeu_ps(acc + i, _mm_max_ps(power, held));
+        } else if constexpr (Reduce == SpectrumReduce_MinHold) {
+            _mm_storeu_ps(acc + i, _mm_min_ps(power, held));
+        } else {
+            _mm_storeu_ps(acc + i, _mm_add_ps(held, power));
+        }
+    }
+    spectrumAccumulateScalar<Reduce>(x + i, acc + i, n - i);
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("sse2")))
+inline float spectrumPowerRowSSE2(const float * power, float gain, float * out, size_t n)
+{
+    const __m128 vgain = _mm_set1_ps(gain);
+    __m128 vmax = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = spectrumScaledSSE2<Scale>(_mm_mul_ps(_mm_loadu_ps(power + i), vgain));
+        _mm_storeu_ps(out + i, v);
+        vmax = _mm_max_ps(v, vmax);
+    }
+    return std::max(spectrumMaxSSE2(vmax), spectrumPowerScalar<Scale>(power + i, gain, out + i, n - i));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256 spectrumLog2AVX2(__m256 v)
+{
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    const __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), \
+                                                         _mm256_set1_epi32(0x3F800000)));
+    const __m256 t = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+    __m256 poly = _mm256_fmadd_ps(t, _mm256_set1_ps(spectrumLog2C5), _mm256_set1_ps(spectrumLog2C4));
+    poly = _mm256_fmadd_ps(t, poly, _mm256_set1_ps(spectrumLog2C3));
+    poly = _mm256_fmadd_ps(t, poly, _mm256_set1_ps(spectrumLog2C2));
+    poly = _mm256_fmadd_ps(t, poly, _mm256_set1_ps(spectrumLog2C1));
+    return _mm256_fmadd_ps(t, poly, e);
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx2,fma")))
+inline __m256 spectrumScaledAVX2(__m256 v)
+{
+    if constexpr (Scale == SpectrumScale_Magnitude) {
+        return _mm256_sqrt_ps(v);
+    } else if constexpr (Scale == SpectrumScale_Power) {
+        return v;
+    } else {
+        return _mm256_mul_ps(spectrumLog2AVX2(_mm256_max_ps(v, _mm256_set1_ps(spectrumPowerFloor))), \
+                             _mm256_set1_ps(spectrumDecibelScale));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline float spectrumMaxAVX2(__m256 vmax)
+{
+    __m128 lanes = _mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+    lanes = _mm_max_ps(lanes, _mm_movehl_ps(lanes, lanes));
+    lanes = _mm_max_ss(lanes, _mm_shuffle_ps(lanes, lanes, 1));
+    return _mm_cvtss_f32(lanes);
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256 spectrumPowerAVX2(const float * p)
+{
+    const __m256 a = _mm256_loadu_ps(p);
+    const __m256 b = _mm256_loadu_ps(p + 8);
+    // In-lane shuffles give bins {0 1 4 5 | 2 3 6 7}, restored by one permute
+    const __m256 re = _mm256_castpd_ps(_mm256_permute4x64_pd( \
+                          _mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+    const __m256 im = _mm256_castpd_ps(_mm256_permute4x64_pd( \
+                          _mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+    return _mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im));
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx2,fma")))
+inline float spectrumRowAVX2(const std::complex<float> * x, float * out, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    __m256 vmax = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = spectrumScaledAVX2<Scale>(spectrumPowerAVX2(p + 2 * i));
+        _mm256_storeu_ps(out + i, v);
+        vmax = _mm256_max_ps(v, vmax);
+    }
+    return std::max(spectrumMaxAVX2(vmax), spectrumRowScalar<Scale>(x + i, out + i, n - i));
+}
+
+template<SpectrumReduce Reduce>
+__attribute__((target("avx2,fma")))
+inline void spectrumAccumulateAVX2(const std::complex<float> * x, float * acc, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 power = spectrumPowerAVX2(p + 2 * i);
+        const __m256 held = _mm256_loadu_ps(acc + i);
+        if constexpr (Reduce == SpectrumReduce_MaxHold) {
+            _mm256_storeu_ps(acc + i, _mm256_max_ps(power, held));
+        } else if constexpr (Reduce == SpectrumReduce_MinHold) {
+            _mm256_storeu_ps(acc + i, _mm256_min_ps(power, held));
+        } else {
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(held, power));
+        }
+    }
+    spectrumAccumulateScalar<Reduce>(x + i, acc + i, n - i);
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx2,fma")))
+inline float spectrumPowerRowAVX2(const float * power, float gain, float * out, size_t n)
+{
+    const __m256 vgain = _mm256_set1_ps(gain);
+    __m256 vmax = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = spectrumScaledAVX2<Scale>(_mm256_mul_ps(_mm256_loadu_ps(power + i), vgain));
+        _mm256_storeu_ps(out + i, v);
+        vmax = _mm256_max_ps(v, vmax);
+    }
+    return std::max(spectrumMaxAVX2(vmax), spectrumPowerScalar<Scale>(power + i, gain, out + i, n - i));
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx512f")))
+inline __m512 spectrumScaledAVX512(__m512 v)
+{
+    if constexpr (Scale == SpectrumScale_Magnitude) {
+        return _mm512_sqrt_ps(v);
+    } else if constexpr (Scale == SpectrumScale_Power) {
+        return v;
+    } else {
+        // getexp/getmant split the float in two instructions
+        const __m512 floored = _mm512_max_ps(v, _mm512_set1_ps(spectrumPowerFloor));
+        const __m512 e = _mm512_getexp_ps(floored);
+        const __m512 t = _mm512_sub_ps(_mm512_getmant_ps(floored, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero), \
+                                       _mm512_set1_ps(1.0f));
+        __m512 poly = _mm512_fmadd_ps(t, _mm512_set1_ps(spectrumLog2C5), _mm512_set1_ps(spectrumLog2C4));
+        poly = _mm512_fmadd_ps(t, poly, _mm512_set1_ps(spectrumLog2C3));
+        poly = _mm512_fmadd_ps(t, poly, _mm512_set1_ps(spectrumLog2C2));
+        poly = _mm512_fmadd_ps(t, poly, _mm512_set1_ps(spectrumLog2C1));
+        return _mm512_mul_ps(_mm512_fmadd_ps(t, poly, e), _mm512_set1_ps(spectrumDecibelScale));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline __m512 spectrumPowerAVX512(const float * p)
+{
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512 a = _mm512_loadu_ps(p);
+    const __m512 b = _mm512_loadu_ps(p + 16);
+    const __m512 re = _mm512_permutex2var_ps(a, even, b);
+    const __m512 im = _mm512_permutex2var_ps(a, odd, b);
+    return _mm512_fmadd_ps(re, re, _mm512_mul_ps(im, im));
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx512f")))
+inline float spectrumRowAVX512(const std::complex<float> * x, float * out, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    __m512 vmax = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 v = spectrumScaledAVX512<Scale>(spectrumPowerAVX512(p + 2 * i));
+        _mm512_storeu_ps(out + i, v);
+        vmax = _mm512_max_ps(v, vmax);
+    }
+    return std::max(_mm512_reduce_max_ps(vmax), spectrumRowScalar<Scale>(x + i, out + i, n - i));
+}
+
+template<SpectrumReduce Reduce>
+__attribute__((target("avx512f")))
+inline void spectrumAccumulateAVX512(const std::complex<float> * x, float * acc, size_t n)
+{
+    const float * p = reinterpret_cast<const float *>(x);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 power = spectrumPowerAVX512(p + 2 * i);
+        const __m512 held = _mm512_loadu_ps(acc + i);
+        if constexpr (Reduce == SpectrumReduce_MaxHold) {
+            _mm512_storeu_ps(acc + i, _mm512_max_ps(power, held));
+        } else if constexpr (Reduce == SpectrumReduce_MinHold) {
+            _mm512_storeu_ps(acc + i, _mm512_min_ps(power, held));
+        } else {
+            _mm512_storeu_ps(acc + i, _mm512_add_ps(held, power));
+        }
+    }
+    spectrumAccumulateScalar<Reduce>(x + i, acc + i, n - i);
+}
+
+template<SpectrumScale Scale>
+__attribute__((target("avx512f")))
+inline float spectrumPowerRowAVX512(const float * power, float gain, float * out, size_t n)
+{
+    const __m512 vgain = _mm512_set1_ps(gain);
+    __m512 vmax = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 v = spectrumScaledAVX512<Scale>(_mm512_mul_ps(_mm512_loadu_ps(power + i), vgain));
+        _mm512_storeu_ps(out + i, v);
+        vmax = _mm512_max_ps(v, vmax);
+    }
+    return std::max(_mm512_reduce_max_ps(vmax), spectrumPowerScalar<Scale>(power + i, gain, out + i, n - i));
+}
+#endif // IQCONVERT_X86
+
+/**
+ * @brief Ядра строк спектра, индекс в func и power - SpectrumScale,
+ * в accumulate - SpectrumReduce
+ */
+struct SpectrumKernel {
+    spectrumRowFunc_t func[3]{nullptr, nullptr, nullptr};
+    spectrumPowerFunc_t power[3]{nullptr, nullptr, nullptr};
+    spectrumAccumulateFunc_t accumulate[3]{nullptr, nullptr, nullptr};
+    CpuLevel level{CpuLevel_Scalar};
+};
+
+#define SPECTRUM_KERNEL(Row_T, Power_T, Accumulate_T, Level) \
+    {{Row_T<SpectrumScale_Magnitude>, Row_T<SpectrumScale_Power>, Row_T<SpectrumScale_Decibel>}, \
+     {Power_T<SpectrumScale_Magnitude>, Power_T<SpectrumScale_Power>, Power_T<SpectrumScale_Decibel>}, \
+     {Accumulate_T<SpectrumReduce_Mean>, Accumulate_T<SpectrumReduce_MaxHold>, \
+      Accumulate_T<SpectrumReduce_MinHold>}, Level}
+
+/**
+ * @brief Выбор наиболее широкого ядра не выше cpuLevel()
+ */
+inline SpectrumKernel spectrumSelect(void)
+{
+#ifdef IQCONVERT_X86
+    if (cpuLevel() >= CpuLevel_AVX512)
+        return SPECTRUM_KERNEL(spectrumRowAVX512, spectrumPowerRowAVX512, spectrumAccumulateAVX512, CpuLevel_AVX512);
+    if (cpuLevel() >= CpuLevel_AVX2)
+        return SPECTRUM_KERNEL(spectrumRowAVX2, spectrumPowerRowAVX2, spectrumAccumulateAVX2, CpuLevel_AVX2);
+    if (cpuLevel() >= CpuLevel_SSE2)
+        return SPECTRUM_KERNEL(spectrumRowSSE2, spectrumPowerRowSSE2, spectrumAccumulateSSE2, CpuLevel_SSE2);
+#endif
+    return SPECTRUM_KERNEL(spectrumRowScalar, spectrumPowerScalar, spectrumAccumulateScalar, CpuLevel_Scalar);
+}
+
+#undef SPECTRUM_KERNEL
+
+inline const SpectrumKernel & spectrumKernel(void)
+{
+    static const SpectrumKernel kernel = spectrumSelect();
+    return kernel;
+}
+
+/**
+ * @brief Строка спектра в шкале scale и её максимум за один проход
+ */
+inline float spectrumRow(const std::complex<float> * x, float * out, size_t n, SpectrumScale scale)
+{
+    return spectrumKernel().func[scale](x, out, n);
+}
+
+/**
+ * @brief Свёртка мощности бинов в строку: сумма (Уэлч), максимум или минимум
+ *
+ * Строка перед первым спектром заполняется spectrumReduceInit(reduce).
+ */
+inline void spectrumAccumulate(const std::complex<float> * x, float * acc, size_t n, SpectrumReduce reduce)
+{
+    spectrumKernel().accumulate[reduce](x, acc, n);
+}
+
+/**
+ * @brief Строка из накопленной мощности, умноженной на gain, и её максимум
+ */
+inline float spectrumPowerRow(const float * power, float gain, float * out, size_t n, SpectrumScale scale)
+{
+    return spectrumKernel().power[scale](power, gain, out, n);
+}
+
+// =============================================================================
+
+#endif // SPECTRUM_HPP
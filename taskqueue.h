@@ -0,0 +1,71 @@
+#ifndef TASKQUEUE_H
+#define TASKQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief Потокобезопасная очередь задач для рабочих потоков
+ *
+ * Производитель добавляет задачи по мере готовности данных и закрывает
+ * очередь после последней задачи. Потребители блокируются в pop() до
+ * появления задачи либо до закрытия опустевшей очереди.
+ */
+template<class T>
+class TaskQueue {
+protected:
+    std::deque<T> items;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    bool closed{false};
+
+public:
+    void push(T item) {
+        {
+            std::lock_guard<std::mutex> lock(this->queueMutex);
+            this->items.push_back(std::move(item));
+        }
+        this->queueCond.notify_one();
+    }
+
+    /**
+     * @brief Извлечение задачи из очереди
+     * @param item Извлечённая задача
+     * @return false, если очередь закрыта и пуста
+     */
+    bool pop(T & item) {
+        std::unique_lock<std::mutex> lock(this->queueMutex);
+        this->queueCond.wait(lock, [this]() {
+            return !this->items.empty() || this->closed;
+        });
+        if (this->items.empty()) {
+            return false;
+        }
+        item = std::move(this->items.front());
+        this->items.pop_front();
+        return true;
+    }
+
+    void close(void) {
+        {
+            std::lock_guard<std::mutex> lock(this->queueMutex);
+            this->closed = true;
+        }
+        this->queueCond.notify_all();
+    }
+
+    /**
+     * @brief Сброс очереди в исходное состояние (открыта, пуста)
+     */
+    void reset(void) {
+        std::deque<T> dropped;
+        {
+            std::lock_guard<std::mutex> lock(this->queueMutex);
+            dropped.swap(this->items);
+            this->closed = false;
+        }
+    }
+};
+
+#endif // TASKQUEUE_H
@@ -33,6 +33,7 @@ WaterfallViewer::WaterfallViewer(QWidget *parent)
     colorScale->axis()->setLabel("Signal amplitude");
     
     this->ui->plotter->addLayer("Dots");
+    this->ui->plotter->addLayer("Overlay");
     
     this->toolBar = new CustomToolBar(this);
     this->toolBar->draw(this->ui->topToolBar);
@@ -40,8 +41,13 @@ WaterfallViewer::WaterfallViewer(QWidget *parent)
     connect(toolBar, &CustomToolBar::onSampleRate_TextChanged, this, &WaterfallViewer::sampleRateChanged);
     connect(toolBar, &CustomToolBar::onFFTOrder_TextChanged, this, &WaterfallViewer::fftOrderChanged);
     connect(toolBar, &CustomToolBar::onScaleFactor_TextChanged, this, &WaterfallViewer::scaleFactorChanged);
+    connect(toolBar, &CustomToolBar::onAverageCount_TextChanged, this, &WaterfallViewer::averageCountChanged);
+    connect(toolBar, &CustomToolBar::onPFBTaps_TextChanged, this, &WaterfallViewer::pfbTapsChanged);
+    connect(toolBar, &CustomToolBar::onSampleFormat_IndexChanged, this, &WaterfallViewer::sampleFormatChanged);
+    connect(toolBar, &CustomToolBar::onTimeOffset_TextChanged, this, &WaterfallViewer::timeOffsetChanged);
+    connect(toolBar, &CustomToolBar::onTimeLength_TextChanged, this, &WaterfallViewer::timeLengthChanged);
     
-    // Обновление параметров анализа (fs, fft_order, scale)
+    // Обновление параметров анализа (fs, fft_order, scale, format, time range)
     this->toolBar->emitAll();
 
     this->utilBar = new UtilityToolBar(this->ui->bottomToolBar, this);
@@ -49,6 +55,10 @@ WaterfallViewer::WaterfallViewer(QWidget *parent)
 
     connect(this->utilBar, &UtilityToolBar::completeProcessing, this, &WaterfallViewer::onProcessingComplete);
 
+    // Appends to the followed record (inotify on Linux) trigger tail passes
+    this->recordWatcher = new QFileSystemWatcher(this);
+    connect(this->recordWatcher, &QFileSystemWatcher::fileChanged, this, &WaterfallViewer::recordFileChanged);
+
     // Create workers ==========================================================
     this->availThreads = std::thread::hardware_concurrency() / 2;
     this->workers.resize(availThreads);
@@ -59,13 +69,45 @@ WaterfallViewer::WaterfallViewer(QWidget *parent)
     }
     // =========================================================================
 
+    // CPU dispatch ============================================================
+    // Kernels are selected here, before the first pass; "cpu/maxLevel" caps
+    // the level (scalar, sse2, sse4.1, avx2) to compare the paths on one machine
+    QSettings settings;
+    if (!settings.contains("cpu/maxLevel")) {
+        settings.setValue("cpu/maxLevel", "auto");
+    }
+    const QString maxLevel = settings.value("cpu/maxLevel").toString();
+    cpuLevelLimit(cpuLevelParse(maxLevel.toStdString().c_str(), CpuLevel_AVX512));
+    QString cpuMsg = "CPU: " + QString(cpuLevelName(cpuLevelDetect()));
+    if (cpuLevel() != cpuLevelDetect()) {
+        cpuMsg += ", limited to " + QString(cpuLevelName(cpuLevel()));
+    }
+    this->appendConsole(cpuMsg + ";");
+    QStringList kernels;
+    for (const auto & kernel : ColorMapWorker::kernelLevels()) {
+        kernels << QString(kernel.first) + " " + cpuLevelName(kernel.second);
+    }
+    kernels << QString("zoom band ") + cpuLevelName(ddcKernel().level);
+    this->appendConsole("Kernels: " + kernels.join(", ") + ";");
+    // =========================================================================
+
     // Initial state for colorscheme settings ==================================
     this->ui->actionSpectrum->trigger();
+    this->ui->actionScaleMagnitude->trigger();
+    this->ui->actionWindowHann->trigger();
+    this->ui->actionReduceMean->trigger();
     // =========================================================================
 }
 
 WaterfallViewer::~WaterfallViewer()
 {
+    this->compressStop.store(true);
+    if (this->compressThread.joinable())
+        this->compressThread.join();
+    this->ddcStop.store(true);
+    if (this->ddcThread.joinable())
+        this->ddcThread.join();
+    this->stopProcessing();
     delete ui;
 }
 
@@ -75,11 +117,11 @@ void WaterfallViewer::on_actionOpen_file_triggered()
 #ifdef WIN32
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     tr("Open record"), "C:\\", \
-                                                    tr("Record files (*.bin *.dat *.pcm *.iq16)"));
+                                                    tr("Record files (*.bin *.dat *.pcm *.iq16 *.cs8 *.cu8 *.cs16 *.cs16be *.cf32 *.cfile *.cf64 *.rs16 *.r16 *.sigmf-meta *.sigmf-data *.wfiq);;Real records (*.rs16 *.r16)"));
 #elif __unix__
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     tr("Open record"), "/home", \
-                                                    tr("Record files (*.bin *.dat *.pcm *.iq16)"));
+                                                    tr("Record files (*.bin *.dat *.pcm *.iq16 *.cs8 *.cu8 *.cs16 *.cs16be *.cf32 *.cfile *.cf64 *.rs16 *.r16 *.sigmf-meta *.sigmf-data *.wfiq);;Real records (*.rs16 *.r16)"));
 #else
 #error What is this operating system?
 #endif
@@ -89,23 +131,6 @@ void WaterfallViewer::on_actionOpen_file_triggered()
         return;
     }
     
-    if (QFileInfo(fileName).size() > maxFileSize) {
-        QMessageBox oversizingWarning;
-        oversizingWarning.setText("Target file too large");
-        oversizingWarning.setInformativeText("Target file size: " + QString::number((double)QFileInfo(fileName).size() / 1024.0 / 1024.0) + \
-                                             " MB\nWould you like to read the first " + (double)WaterfallViewer::maxFileSize / 1024.0 / 1024.0 + \
-                                             " MB of data, starting at offset zero?");
-        oversizingWarning.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
-        oversizingWarning.setIcon(QMessageBox::Warning);
-
-        int ret = oversizingWarning.exec();
-
-        if (ret == QMessageBox::Cancel) {
-            this->ui->statusbar->showMessage("Processing operation aborted");
-            return;
-        }
-    }
-
     this->selectedFile = fileName;
 
     this->filesVector.emplace_back(fileName);
@@ -182,14 +207,20 @@ void WaterfallViewer::sampleRateChanged(const QString &text)
 
 void WaterfallViewer::fftOrderChanged(const QString &text)
 {
+    // Small values are orders (size 2^order), larger ones are sizes in points,
+    // so bins can follow a channel raster (1000, 1536, 6000...)
     bool ret = false;
-    double fftOrder = text.toUInt(&ret);
-    if (ret) {
-        this->fftOrder = fftOrder;
-        this->ui->statusbar->showMessage("New FFT order applied");
+    uint32_t value = text.toUInt(&ret);
+    if (ret && value > 0 && value <= WaterfallViewer::maxFFTOrder && \
+            pow2(value) <= WaterfallViewer::maxFFTSize) {
+        this->fftSize = pow2(value);
+        this->ui->statusbar->showMessage("New FFT order applied [" + QString::number(this->fftSize) + " points]");
+    } else if (ret && value > WaterfallViewer::maxFFTOrder && value <= WaterfallViewer::maxFFTSize) {
+        this->fftSize = value;
+        this->ui->statusbar->showMessage("New FFT size applied");
     } else {
-        this->fftOrder = 10;
-        this->ui->statusbar->showMessage("Wrong FFT order format [default " + QString::number(fftOrder) + "]");
+        this->fftSize = 1024;
+        this->ui->statusbar->showMessage("Wrong FFT order format [default " + QString::number(fftSize) + " points]");
     }
 }
 
@@ -206,6 +237,87 @@ void WaterfallViewer::scaleFactorChanged(const QString &text)
     }
 }
 
+void WaterfallViewer::averageCountChanged(const QString &text)
+{
+    bool ret = false;
+    uint32_t value = text.toUInt(&ret);
+    if (ret && value > 0) {
+        this->average = value;
+        this->ui->statusbar->showMessage("New averaging applied");
+    } else {
+        this->average = 1;
+        this->ui->statusbar->showMessage("Wrong averaging format [default 1, no averaging]");
+    }
+}
+
+void WaterfallViewer::pfbTapsChanged(const QString &text)
+{
+    bool ret = false;
+    uint32_t value = text.toUInt(&ret);
+    if (ret && value > 0 && value <= WaterfallViewer::maxPFBTaps) {
+        this->pfbTaps = value;
+        this->ui->statusbar->showMessage("New filter bank taps applied");
+    } else {
+        this->pfbTaps = 1;
+        this->ui->statusbar->showMessage("Wrong filter bank taps format [1 - " + \
+                                         QString::number(WaterfallViewer::maxPFBTaps) + ", default 1, plain FFT]");
+    }
+}
+
+void WaterfallViewer::sampleFormatChanged(int index)
+{
+    this->sampleFormatIndex = index;
+    if (index == 0) {
+        this->ui->statusbar->showMessage("Sample format follows file extension");
+    } else {
+        this->ui->statusbar->showMessage("New sample format applied");
+    }
+}
+
+void WaterfallViewer::timeOffsetChanged(const QString &text)
+{
+    bool ret = false;
+    double offset = text.toDouble(&ret);
+    if (ret && offset >= 0) {
+        this->timeOffset = offset;
+        this->ui->statusbar->showMessage("New time offset applied");
+    } else {
+        this->timeOffset = 0.0;
+        this->ui->statusbar->showMessage("Wrong time offset format [default " + QString::number(timeOffset) + "]");
+    }
+}
+
+void WaterfallViewer::timeLengthChanged(const QString &text)
+{
+    bool ret = false;
+    double length = text.toDouble(&ret);
+    if (ret && length >= 0) {
+        this->timeLength = length;
+        this->ui->statusbar->showMessage("New time length applied");
+    } else {
+        this->timeLength = 0.0;
+        this->ui->statusbar->showMessage("Wrong time length format [default " + QString::number(timeLength) + "]");
+    }
+}
+
+void WaterfallViewer::on_actionProcessSelection_triggered()
+{
+    if (this->dotGraphKeys.size() != 2 || this->selectedFile.isEmpty()) {
+        this->ui->statusbar->showMessage("Select two points on the waterfall first");
+        return;
+    }
+
+    // Selected rows of the current pass back to absolute record time
+    const double sampleRate = Fs / 2.0;
+    const double firstRow = std::max(0.0, std::min(fPoint.second, sPoint.second));
+    const double lastRow = std::max(0.0, std::max(fPoint.second, sPoint.second));
+    const double offset = (this->rangeFirst + firstRow * this->rangeStep) / sampleRate;
+    const double length = ((lastRow - firstRow) * this->rangeStep + this->rangeSpan) / sampleRate;
+
+    this->toolBar->setTimeRange(offset, length);
+    this->startProcessing();
+}
+
 void WaterfallViewer::onProcessingComplete()
 {
     std::vector<float> maximums(this->workers.size());
@@ -213,28 +325,180 @@ void WaterfallViewer::onProcessingComplete()
         maximums[i] = this->workers[i]->getMaxValue();
     }
 
-    colorMap->setDataRange(QCPRange(0, *std::max_element(std::begin(maximums), \
-                                                         std::end(maximums))));
+    // Tail passes only see the new rows, keep the maximum of the whole map
+    float maxValue = *std::max_element(std::begin(maximums), std::end(maximums));
+    if (this->tailPass) {
+        maxValue = std::max(maxValue, this->maxColorValue.load());
+    }
+    this->maxColorValue.store(maxValue);
 
-    this->ui->plotter->rescaleAxes();
+    // Scale of the map is the one of its full pass, tail passes reuse it
+    const SpectrumScale scale = this->tailParams.scale;
+    if (!std::isfinite(maxValue)) {
+        maxValue = 0;
+    }
+    if (scale == SpectrumScale_Decibel) {
+        colorScale->axis()->setLabel("Power, dB");
+        colorMap->setDataRange(QCPRange(maxValue - WaterfallViewer::decibelSpan, maxValue));
+    } else {
+        colorScale->axis()->setLabel(scale == SpectrumScale_Power ? "Signal power" : "Signal amplitude");
+        colorMap->setDataRange(QCPRange(0, maxValue));
+    }
+
+    if (this->tailPass) {
+        // Keep the visible time span, anchored at the newest row
+        const QCPRange visible = this->ui->plotter->yAxis->range();
+        const double last = this->tailRows;
+        this->ui->plotter->yAxis->setRange(std::max(0.0, last - visible.size()), last);
+    } else {
+        this->ui->plotter->rescaleAxes();
+    }
     this->ui->plotter->replot();
 
-    for (ColorMapWorkerTask * item : this->tasks) {
-        if (item != nullptr)
-            delete item;
+    this->stopProcessing();
+
+    if (this->tailPending) {
+        this->tailPending = false;
+        this->startTailProcessing();
     }
-    tasks.clear();
+}
+
+void WaterfallViewer::stopProcessing()
+{
+    // Workers must be joined before their tasks (and the mapping) go away
+    this->streamer.abortStreaming();
+    this->tasks.close();
 
     for (ColorMapWorker * item : this->workers) {
         if (item != nullptr) {
             item->abortProcessing();
         }
     }
+
+    this->tasks.reset();
+    this->processingActive = false;
+}
+
+void WaterfallViewer::startTailProcessing()
+{
+    if (!this->tailFollowable || this->colorMap == nullptr) {
+        return;
+    }
+
+    this->stopProcessing();
+
+    // Remap to pick up the appended samples
+    if (!this->source.open(this->tailFile, this->tailFormat, this->tailMapAll)) {
+        this->ui->statusbar->showMessage("Error on mapping record file");
+        return;
+    }
+
+    const uint64_t recordSize = this->source.size();
+    if (recordSize < this->rangeFirst + this->rangeSpan) {
+        return;
+    }
+    const size_t rows = (recordSize - this->rangeFirst - this->rangeSpan) / this->rangeStep + 1;
+    if (rows <= this->tailRows) {
+        return;
+    }
+
+    // QCPColorMapData::setSize drops the cells, so the map grows into a new
+    // buffer with headroom and the computed rows are copied, not recomputed
+    QCPColorMapData * data = this->colorMap->data();
+    if (rows > (size_t)data->valueSize()) {
+        size_t capacity = std::max<size_t>(rows, data->valueSize() * 3 / 2);
+        if ((uint64_t)capacity * this->tailWindowSize * sizeof (double) > WaterfallViewer::maxColorMapSize) {
+            capacity = rows;
+        }
+        QCPColorMapData * grown = new QCPColorMapData(this->tailWindowSize, capacity, \
+                                                      QCPRange(0, this->tailWindowSize), QCPRange(0, capacity));
+        for (size_t row = 0; row < this->tailRows; row++) {
+            for (size_t l = 0; l < this->tailWindowSize; l++) {
+                grown->setCell(l, row, data->cell(l, row));
+            }
+        }
+        this->colorMap->setData(grown, false);
+    }
+
+    const size_t firstRow = this->tailRows;
+    const size_t newRows = rows - firstRow;
+
+    this->utilBar->resetProgress();
+    this->utilBar->setMode(UtilityToolBar::UtilityToolBar_Progress_Mode_DataProcessing);
+    this->utilBar->setTotalOperations(newRows);
+
+    for (ColorMapWorker * item : this->workers) {
+        item->setParams(this->tailParams);
+        item->startProcessing();
+    }
+
+    if (!this->streamer.startStreaming(this->colorMap, this->rangeFirst + (uint64_t)firstRow * this->rangeStep, \
+                                       newRows, this->tailWindowSize, this->rangeStep, \
+                                       WaterfallViewer::streamingBudget, 2 * this->workers.size(), \
+                                       this->tailIoMode, firstRow, this->rangeSpan)) {
+        this->ui->statusbar->showMessage("Error on opening read stream");
+        this->stopProcessing();
+        return;
+    }
+
+    this->tailRows = rows;
+    this->tailPass = true;
+    this->processingActive = true;
+}
+
+void WaterfallViewer::updateRecordWatch()
+{
+    if (!this->recordWatcher->files().isEmpty()) {
+        this->recordWatcher->removePaths(this->recordWatcher->files());
+    }
+    if (this->ui->actionFollow->isChecked() && this->tailFollowable) {
+        this->recordWatcher->addPath(this->tailFile);
+    }
+}
+
+void WaterfallViewer::on_actionFollow_triggered(bool checked)
+{
+    this->updateRecordWatch();
+    if (!checked) {
+        this->tailPending = false;
+        this->ui->statusbar->showMessage("Record follow mode disabled");
+        return;
+    }
+    if (!this->tailFollowable) {
+        this->ui->statusbar->showMessage("Follow mode needs an uncompressed record processed up to its end");
+        return;
+    }
+
+    this->ui->statusbar->showMessage("Following " + this->tailFile);
+    // Catch up with everything written since the last pass
+    if (this->processingActive) {
+        this->tailPending = true;
+    } else {
+        this->startTailProcessing();
+    }
+}
+
+void WaterfallViewer::recordFileChanged(const QString & path)
+{
+    // Recreated files drop out of the watch list
+    if (!this->recordWatcher->files().contains(path) && QFileInfo::exists(path)) {
+        this->recordWatcher->addPath(path);
+    }
+    if (!this->ui->actionFollow->isChecked()) {
+        return;
+    }
+    // Appends arriving during a pass are picked up by a single next pass
+    if (this->processingActive) {
+        this->tailPending = true;
+    } else {
+        this->startTailProcessing();
+    }
 }
 
 void WaterfallViewer::cleanPlotter() {
     this->ui->plotter->clearPlottables();
     this->ui->plotter->clearGraphs();
+    this->ui->plotter->clearItems();
 
     this->dotGraph = this->ui->plotter->addGraph();
     this->dotGraph->setLayer("Dots");
@@ -248,48 +512,122 @@ void WaterfallViewer::cleanPlotter() {
 
 void WaterfallViewer::startProcessing()
 {
-    const uint32_t windowSize = std::pow(2, this->fftOrder);
+    this->stopProcessing();
+    this->tailPending = false;
+    this->tailFollowable = false;
+
+    QString dataFile = this->selectedFile;
+    SampleFormat format = this->recordFormat();
+
+    // SigMF metadata overrides the toolbar format and sample rate
+    this->sigmfRecord = SigMFMeta::isSigMF(this->selectedFile);
+    if (this->sigmfRecord) {
+        QString error;
+        if (!this->sigmf.load(this->selectedFile, error)) {
+            this->ui->statusbar->showMessage(error);
+            return;
+        }
+        dataFile = SigMFMeta::dataPath(this->selectedFile);
+        format = this->sigmf.format;
+        this->applySigMFMeta();
+    }
+
+    // Real records are processed as packed pairs of samples: N real
+    // samples make N / 2 pairs and as many bins of the half spectrum.
+    // Toolbar Fs is then the real sample rate and the pair rate is Fs / 2,
+    // so bin width and row timing below are the same as for complex records
+    const bool realInput = sampleFormatIsReal(format);
+    if (realInput && this->fftSize % 2 != 0) {
+        this->ui->statusbar->showMessage("Real records need an even FFT size");
+        return;
+    }
+    const uint32_t windowSize = realInput ? this->fftSize / 2 : this->fftSize;
     fftResolution = Fs / 2.0 / (double)windowSize;
 
-    QFileInfo fileInfo(this->selectedFile);
+    // Mapping is cheap, remap on every pass to pick up the current file size.
+    // Streaming mode maps only the chunks currently in work, reader modes
+    // do not map the record at all
+    uint16_t ioMode = ChunkStreamer::ChunkStreamer_Mode_Mapped;
+    if (this->ui->actionReaderThread->isChecked()) {
+        ioMode = this->ui->actionDirectIO->isChecked() ? ChunkStreamer::ChunkStreamer_Mode_DirectRead : \
+                                                         ChunkStreamer::ChunkStreamer_Mode_Read;
+    }
+    const bool mapAll = (ioMode == ChunkStreamer::ChunkStreamer_Mode_Mapped) && \
+            !this->ui->actionStreaming->isChecked();
+
+    if (!this->source.open(dataFile, format, mapAll)) {
+        this->ui->statusbar->showMessage("Error on mapping record file");
+        return;
+    }
+    this->appendConsole("Sample format: " + QString(sampleFormatName(this->source.format())) + ";");
+    if (realInput) {
+        this->appendConsole("Real input: " + QString::number(2 * windowSize) + "-point FFT, " + \
+                            QString::number(windowSize) + " bins [0, Fs / 2);");
+    }
 
-    uint64_t fileSize = fileInfo.size();
-    if (fileSize > WaterfallViewer::maxFileSize) {
-        fileSize = WaterfallViewer::maxFileSize;
+    // Compressed containers carry their own format and are always read block by block
+    if (this->source.isCompressed()) {
+        ioMode = ChunkStreamer::ChunkStreamer_Mode_Container;
     }
 
-    std::ifstream readFile(this->selectedFile.toStdString(), std::ios::binary);
-    if (!readFile.is_open()) {
-        this->ui->statusbar->showMessage("Error on opening read stream");
+    // Requested time range in complex samples (complex rate is Fs / 2)
+    const uint64_t recordSize = this->source.size();
+    const uint64_t first = std::llround(std::max(0.0, this->timeOffset) * Fs / 2.0);
+    if (first >= recordSize) {
+        this->ui->statusbar->showMessage("Time offset is beyond the end of record");
         return;
     }
 
-    iq16_t sample;
-    std::complex<float> tmp;
-    bool pushing = false;
-    if ((this->complexSignal.size() != (fileSize / sizeof (iq16_t))) && !complexSignal.empty()) {
-        this->complexSignal.resize(fileSize / sizeof (iq16_t));
-    } else {
-        pushing = true;
+    uint64_t verticalSize = recordSize - first;
+    if (this->timeLength > 0) {
+        verticalSize = std::min<uint64_t>(verticalSize, std::llround(this->timeLength * Fs / 2.0));
     }
-    for (size_t i = 0; i < fileSize / sizeof (iq16_t); i++) {
-        readFile.read((char*)&sample, sizeof (iq16_t));
-        tmp.real((float)sample.I);
-        tmp.imag((float)sample.Q);
-        if (pushing)
-            this->complexSignal.push_back(tmp);
-        else
-            this->complexSignal[i] = tmp;
+    // Averaged rows hold this->average transforms hop samples apart, and
+    // the rows themselves move by all of them. A filter bank transform
+    // reads pfbTaps windows
+    const size_t hop = std::max<size_t>(1, windowSize * scale);
+    const size_t step = hop * this->average;
+    const size_t span = windowSize * this->pfbTaps + hop * (this->average - 1);
+
+    if (verticalSize < span) {
+        this->ui->statusbar->showMessage(this->average > 1 ? "Record is shorter than one averaged row" : \
+                                                             "Record is shorter than FFT window");
+        return;
     }
-    readFile.close();
 
-    uint64_t verticalSize = this->complexSignal.size();
+    ts = (double)2 / Fs * (double)step;
+
+    // Last row must end inside the mapped record
+    size_t maps = (verticalSize - span) / step + 1;
 
-    ts = (double)2 / Fs * (double)windowSize * scale;
+    this->rangeFirst = first;
+    this->rangeStep = step;
+    this->rangeSpan = span;
+    if (this->average > 1) {
+        this->appendConsole("Averaging: " + QString::number(this->average) + " transforms per row, " + \
+                            QString::number(hop) + " samples apart, " + \
+                            spectrumReduceName(this->selectedReduce()) + ";");
+    }
+    if (first != 0 || verticalSize != recordSize) {
+        this->appendConsole("Range: samples " + QString::number(first) + " - " + \
+                            QString::number(first + verticalSize) + ";");
+    }
 
-    size_t maps = ( verticalSize - (verticalSize % (uint64_t)(windowSize * scale))) / (scale * windowSize) - 1;
+    if ((uint64_t)maps * windowSize * sizeof (double) > WaterfallViewer::maxColorMapSize) {
+        QMessageBox oversizingWarning;
+        oversizingWarning.setText("Color map too large");
+        oversizingWarning.setInformativeText("Color map size: " + QString::number((double)maps * windowSize * sizeof (double) / 1024.0 / 1024.0) + \
+                                             " MB\nIncrease the scale factor to reduce the number of rows.\nWould you like to continue anyway?");
+        oversizingWarning.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
+        oversizingWarning.setIcon(QMessageBox::Warning);
 
-    tasks.resize(maps);
+        int ret = oversizingWarning.exec();
+
+        if (ret == QMessageBox::Cancel) {
+            this->ui->statusbar->showMessage("Processing operation aborted");
+            return;
+        }
+    }
 
     this->cleanPlotter();
 
@@ -303,10 +641,8 @@ void WaterfallViewer::startProcessing()
 
     this->updateColorScheme();
 
-    for (size_t i = 0; i < maps; i++) {
-        tasks[i] = new ColorMapWorkerTask(&this->complexSignal, \
-                                          this->colorMap, \
-                                          i, windowSize, windowSize * scale);
+    if (this->sigmfRecord) {
+        this->drawSigMFOverlay(windowSize, step, maps);
     }
 
     this->utilBar->resetProgress();
@@ -315,9 +651,370 @@ void WaterfallViewer::startProcessing()
 
     this->ui->plotter->rescaleAxes();
 
+    ColorMapWorkerParams params = this->workerParams(windowSize);
+    params.average = this->average;
+
     for (ColorMapWorker * item : this->workers) {
+        item->setParams(params);
         item->startProcessing();
     }
+
+    if (!this->streamer.startStreaming(this->colorMap, first, maps, windowSize, step, \
+                                       WaterfallViewer::streamingBudget, 2 * this->workers.size(), ioMode, 0, span)) {
+        this->ui->statusbar->showMessage("Error on opening read stream");
+        this->stopProcessing();
+        return;
+    }
+
+    this->processingActive = true;
+    this->tailPass = false;
+
+    // Open-ended passes over plain records can be extended by tail passes
+    this->tailFile = dataFile;
+    this->tailFormat = format;
+    this->tailIoMode = ioMode;
+    this->tailMapAll = mapAll;
+    this->tailWindowSize = windowSize;
+    this->tailRows = maps;
+    this->tailParams = params;
+    this->tailFollowable = !this->source.isCompressed() && this->timeLength <= 0;
+    this->updateRecordWatch();
+
+    if (ioMode == ChunkStreamer::ChunkStreamer_Mode_Container) {
+        this->appendConsole("I/O: compressed container, " + \
+                            QString::number(this->source.container().blocksCount()) + " blocks;");
+    } else if (ioMode != ChunkStreamer::ChunkStreamer_Mode_Mapped) {
+        this->appendConsole(this->streamer.isDirect() ? "I/O: reader thread, direct;" : "I/O: reader thread, buffered;");
+    }
+}
+
+ColorMapWorkerParams WaterfallViewer::workerParams(size_t windowSize)
+{
+    ColorMapWorkerParams params;
+
+    params.scale = this->selectedScale();
+    params.reduce = this->selectedReduce();
+    params.dcRemoval = this->ui->actionDCRemoval->isChecked();
+    if (params.dcRemoval) {
+        // DC offset is estimated once from the head of the processed range
+        uint64_t count = std::min(this->source.size() - this->rangeFirst, WaterfallViewer::dcEstimateSamples);
+        const uchar * head = this->source.mapRegion(this->rangeFirst, count);
+        if (head != nullptr) {
+            dispatchSampleFormat(this->source.format(), [&params, head, count](auto sample) {
+                params.dcOffset = sampleMean(reinterpret_cast<const decltype(sample) *>(head), count);
+            });
+            this->source.unmapRegion(head);
+        } else {
+            this->appendConsole("DC offset can not be estimated for this source, removal is skipped;");
+        }
+        this->appendConsole("DC offset: I = " + QString::number(params.dcOffset.real()) + \
+                            "; Q = " + QString::number(params.dcOffset.imag()) + ";");
+    }
+
+    // FFT backend is read on every pass, so backends can be compared on the
+    // same record by editing the settings entry between passes
+    QSettings settings;
+    if (!settings.contains("fft/backend")) {
+        settings.setValue("fft/backend", "builtin");
+    }
+    const QString backendName = settings.value("fft/backend").toString();
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QDir().mkpath(configDir);
+    FFTBackend * backend = fftBackendFind(backendName.toStdString(), (configDir + "/fftwf.wisdom").toStdString());
+    if (backend != nullptr) {
+        // Planning (and FFTW measuring) happens here, once per size, and
+        // the workers get the ready plan
+        params.backend = backend->prepare(windowSize);
+    } else if (backendName != "builtin") {
+        QStringList names;
+        for (const std::string & name : fftBackendNames()) {
+            names << QString::fromStdString(name);
+        }
+        this->appendConsole("FFT backend " + backendName + " is not available in this build (" + \
+                            names.join(", ") + "), built-in kernels are used;");
+    }
+    this->appendConsole("FFT backend: " + QString(backend != nullptr ? backend->name() : "builtin") + ";");
+
+    // Quick look: block floating point in int16, only for int16 records of
+    // 2^n points on the built-in kernels
+    if (!settings.contains("fft/fixedPoint")) {
+        settings.setValue("fft/fixedPoint", false);
+    }
+    params.fixedPoint = settings.value("fft/fixedPoint").toBool();
+    if (params.fixedPoint) {
+        const SampleFormat format = this->source.format();
+        if ((format == SampleFormat_CS16 || format == SampleFormat_RS16) && params.backend == nullptr && \
+                fftIsPow2(windowSize) && windowSize >= pow2(fftFixedMinOrder)) {
+            this->appendConsole("FFT: Q15 block floating point, quick look;");
+        } else {
+            this->appendConsole("Fixed-point FFT needs a cs16 or rs16 record, a 2^n size of at least " + \
+                                QString::number(pow2(fftFixedMinOrder)) + " and built-in kernels, float is used;");
+        }
+    }
+    // Window tables are built here, once per size, and shared by the workers
+    if (!settings.contains("fft/kaiserBeta")) {
+        settings.setValue("fft/kaiserBeta", 8.6);
+    }
+    const WindowFunction function = this->selectedWindow();
+    const double beta = settings.value("fft/kaiserBeta").toDouble();
+    const FFTWindow & window = FFTWindow::get(function, windowSize, sampleFormatIsReal(this->source.format()), \
+                                              beta, this->pfbTaps);
+    if (function != WindowFunction_Rectangular || this->pfbTaps > 1) {
+        params.window = &window;
+        QString name = windowFunctionName(function);
+        if (function == WindowFunction_Kaiser) {
+            name += " (beta " + QString::number(beta) + ")";
+        }
+        if (this->pfbTaps > 1) {
+            name = "filter bank, " + QString::number(this->pfbTaps) + " taps per channel, " + name + " prototype";
+        }
+        this->appendConsole("Window: " + name + ", coherent gain " + QString::number(window.coherentGain(), 'f', 3) + \
+                            " (corrected), ENBW " + QString::number(window.enbw(), 'f', 2) + " bins;");
+        if (params.fixedPoint && this->pfbTaps > 1) {
+            this->appendConsole("Fixed-point FFT has no filter bank front end, float is used;");
+        }
+    }
+    if (params.backend == nullptr && !fftIsPow2(windowSize)) {
+        // Mixed-radix and Bluestein plans are built here as well, not by the first worker
+        const FFTMixedPlan & plan = FFTMixedPlan::get(windowSize);
+        this->appendConsole("FFT size " + QString::number(windowSize) + ": " + \
+                            QString::fromStdString(plan.describe()) + ";");
+    }
+
+    return params;
+}
+
+void WaterfallViewer::applySigMFMeta()
+{
+    if (!std::isnan(this->sigmf.sampleRate)) {
+        // Toolbar Fs is twice the complex sample rate (displayed span is Fs / 2)
+        this->toolBar->setSampleRate(QString::number(2.0 * this->sigmf.sampleRate, 'g', 12));
+    }
+
+    this->appendConsole("SigMF record: " + QString::number(this->sigmf.captures.size()) + " captures, " + \
+                        QString::number(this->sigmf.annotations.size()) + " annotations;");
+    for (const SigMFCapture & capture : this->sigmf.captures) {
+        QString msg = "Capture at sample " + QString::number(capture.sampleStart);
+        if (!std::isnan(capture.frequency)) {
+            msg += ": " + QString::number(capture.frequency / 1e6) + " MHz";
+        }
+        this->appendConsole(msg + ";");
+    }
+}
+
+void WaterfallViewer::drawSigMFOverlay(size_t windowSize, size_t step, size_t maps)
+{
+    // A row covers rangeSpan samples: filter bank taps and averaged transforms
+    const uint64_t lastSample = (uint64_t)(maps - 1) * step + this->rangeSpan;
+    const double span = Fs / 2.0;
+
+    QPen overlayPen(Qt::white);
+    overlayPen.setStyle(Qt::DashLine);
+
+    for (size_t index : this->sigmf.annotationsInRange(this->rangeFirst, this->rangeFirst + lastSample)) {
+        const SigMFAnnotation & mark = this->sigmf.annotations[index];
+
+        double top = ((double)mark.sampleStart - this->rangeFirst) / step;
+        double bottom = ((double)mark.sampleStart + mark.sampleCount - this->rangeFirst) / step;
+        double left = 0;
+        double right = windowSize;
+
+        // Bins start at fc - span / 2 after the half replacement
+        double fc = this->sigmf.frequencyAt(mark.sampleStart);
+        if (!std::isnan(fc) && !std::isnan(mark.freqLower) && !std::isnan(mark.freqUpper)) {
+            left = (mark.freqLower - (fc - span / 2.0)) / span * windowSize;
+            right = (mark.freqUpper - (fc - span / 2.0)) / span * windowSize;
+        }
+
+        QCPItemRect * rect = new QCPItemRect(this->ui->plotter);
+        rect->setLayer("Overlay");
+        rect->setPen(overlayPen);
+        rect->topLeft->setCoords(left, top);
+        rect->bottomRight->setCoords(right, bottom);
+
+        if (!mark.label.isEmpty()) {
+            QCPItemText * text = new QCPItemText(this->ui->plotter);
+            text->setLayer("Overlay");
+            text->setColor(Qt::white);
+            text->setPositionAlignment(Qt::AlignLeft | Qt::AlignBottom);
+            text->position->setCoords(left, top);
+            text->setText(mark.label);
+        }
+    }
+}
+
+void WaterfallViewer::on_actionCompressRecord_triggered()
+{
+    if (this->selectedFile.isEmpty()) {
+        this->ui->statusbar->showMessage("No target file selected");
+        return;
+    }
+    if (this->compressRunning.load()) {
+        this->ui->statusbar->showMessage("Record compression is already running");
+        return;
+    }
+
+    QString input = this->selectedFile;
+    SampleFormat format = this->recordFormat();
+    if (SigMFMeta::isSigMF(input)) {
+        SigMFMeta meta;
+        QString error;
+        if (!meta.load(input, error)) {
+            this->ui->statusbar->showMessage(error);
+            return;
+        }
+        input = SigMFMeta::dataPath(input);
+        format = meta.format;
+    }
+    if (format != SampleFormat_CS16) {
+        this->ui->statusbar->showMessage("Only cs16 records can be compressed");
+        return;
+    }
+
+    QFileInfo info(input);
+    if (info.suffix() == "wfiq") {
+        this->ui->statusbar->showMessage("Record is already compressed");
+        return;
+    }
+    const QString output = info.absolutePath() + "/" + info.completeBaseName() + ".wfiq";
+
+    if (this->compressThread.joinable())
+        this->compressThread.join();
+
+    this->appendConsole("Compressing " + input + " to " + output + ";");
+    this->compressStop.store(false);
+    this->compressRunning.store(true);
+    this->compressThread = std::thread([this, input, output]() {
+        SampleSource record;
+        uint64_t inputBytes = 0;
+        uint64_t outputBytes = 0;
+        if (record.open(input, SampleFormat_CS16, true) && !record.isCompressed()) {
+            inputBytes = record.size() * sizeof (iq16_t);
+            outputBytes = iqContainerWrite(reinterpret_cast<const iq16_t *>(record.data()), record.size(), \
+                                           QFile::encodeName(output).toStdString(), this->compressStop);
+        }
+        QMetaObject::invokeMethod(this, [this, output, inputBytes, outputBytes]() {
+            this->onCompressionComplete(output, inputBytes, outputBytes);
+        }, Qt::QueuedConnection);
+        this->compressRunning.store(false);
+    });
+}
+
+void WaterfallViewer::onCompressionComplete(const QString & output, uint64_t inputBytes, uint64_t outputBytes)
+{
+    if (outputBytes == 0) {
+        this->ui->statusbar->showMessage("Error on compressing record");
+        return;
+    }
+
+    this->appendConsole("Compressed record: " + output + ", ratio " + \
+                        QString::number((double)inputBytes / (double)outputBytes, 'f', 2) + ";");
+    this->filesVector.emplace_back(output);
+    this->updateFileList();
+}
+
+void WaterfallViewer::on_actionZoomBand_triggered()
+{
+    if (this->dotGraphKeys.size() != 2 || this->colorMap == nullptr) {
+        this->ui->statusbar->showMessage("Select two points on the waterfall first");
+        return;
+    }
+    if (this->ddcRunning.load()) {
+        this->ui->statusbar->showMessage("Zoom band conversion is already running");
+        return;
+    }
+    if (this->source.isCompressed()) {
+        this->ui->statusbar->showMessage("Zoom band needs an uncompressed record");
+        return;
+    }
+
+    // Band of the displayed map in Hz from zero frequency. Real records are
+    // downconverted from real samples at Fs, complex ones run at Fs / 2
+    const bool realInput = sampleFormatIsReal(this->tailFormat);
+    const double inputRate = realInput ? Fs : Fs / 2.0;
+    const double zeroBin = realInput ? 0.0 : std::floor(this->tailWindowSize / 2.0);
+    const double lowBin = std::min(fPoint.first, sPoint.first);
+    const double highBin = std::max(fPoint.first, sPoint.first);
+    const double center = ((lowBin + highBin) / 2.0 - zeroBin) * fftResolution;
+    const double bandwidth = std::max(highBin - lowBin, 1.0) * fftResolution;
+
+    // Selected rows of the current pass, in record samples
+    const double firstRow = std::max(0.0, std::min(fPoint.second, sPoint.second));
+    const double lastRow = std::max(0.0, std::max(fPoint.second, sPoint.second));
+    const uint64_t factor = realInput ? 2 : 1;
+    const uint64_t first = factor * (this->rangeFirst + (uint64_t)std::llround(firstRow * this->rangeStep));
+    const uint64_t count = factor * ((uint64_t)std::llround((lastRow - firstRow) * this->rangeStep) + this->rangeSpan);
+
+    DDCPlan plan(center / inputRate, bandwidth / inputRate);
+    if (plan.outputCount(count) == 0) {
+        this->ui->statusbar->showMessage("Selected time range is shorter than the zoom band filter");
+        return;
+    }
+    const double outputRate = inputRate / (double)plan.decimation();
+    const double shift = plan.oscillator().frequency() * inputRate;
+    double frequency = NAN;
+    if (this->sigmfRecord && !std::isnan(this->sigmf.frequencyAt(first / factor))) {
+        frequency = this->sigmf.frequencyAt(first / factor) + shift;
+    }
+
+    const QFileInfo info(this->tailFile);
+    const QString output = info.absolutePath() + "/" + info.completeBaseName() + "_zoom_" + \
+            QString::number(std::llround(shift)) + "Hz.sigmf-data";
+    this->appendConsole("Zoom band: " + QString::number(shift / 1e6) + " MHz, width " + \
+                        QString::number(bandwidth / 1e6) + " MHz, decimation " + \
+                        QString::number(plan.decimation()) + ", " + QString::number(plan.length()) + " taps;");
+
+    if (this->ddcThread.joinable())
+        this->ddcThread.join();
+
+    const QString input = this->tailFile;
+    const SampleFormat format = this->tailFormat;
+    this->ddcStop.store(false);
+    this->ddcRunning.store(true);
+    this->ddcThread = std::thread([this, input, format, output, plan, first, count, factor, outputRate, frequency]() {
+        SampleSource record;
+        uint64_t samples = 0;
+        if (record.open(input, format, true) && !record.isCompressed() && first < factor * record.size()) {
+            samples = ddcWrite(record.data(), format, first, std::min(count, factor * record.size() - first), \
+                               plan, QFile::encodeName(output).toStdString(), this->ddcStop);
+        }
+        QMetaObject::invokeMethod(this, [this, output, samples, outputRate, frequency]() {
+            this->onZoomBandComplete(output, samples, outputRate, frequency);
+        }, Qt::QueuedConnection);
+        this->ddcRunning.store(false);
+    });
+}
+
+void WaterfallViewer::onZoomBandComplete(const QString & output, uint64_t samples, double sampleRate, double frequency)
+{
+    if (samples == 0) {
+        this->ui->statusbar->showMessage("Error on zoom band conversion");
+        return;
+    }
+    const QString meta = SigMFMeta::metaPath(output);
+    if (!SigMFMeta::save(meta, "cf32_le", sampleRate, frequency, "Zoom band of " + this->tailFile)) {
+        this->ui->statusbar->showMessage("Error on writing SigMF metadata");
+        return;
+    }
+
+    this->appendConsole("Zoom band record: " + output + ", " + QString::number(samples) + " samples at " + \
+                        QString::number(sampleRate / 1e6) + " MHz;");
+
+    // The narrowband record gets a fresh waterfall over its whole length
+    this->filesVector.emplace_back(meta);
+    this->updateFileList();
+    this->ui->fileList->setCurrentRow((int)this->filesVector.size() - 1);
+    this->selectedFile = meta;
+    this->toolBar->setTimeRange(0, 0);
+    this->startProcessing();
+}
+
+SampleFormat WaterfallViewer::recordFormat()
+{
+    if (this->sampleFormatIndex > 0) {
+        return (SampleFormat)(this->sampleFormatIndex - 1);
+    }
+    return sampleFormatFromExtension(QFileInfo(this->selectedFile).suffix().toStdString());
 }
 
 void WaterfallViewer::updateColorScheme()
@@ -397,6 +1094,115 @@ void WaterfallViewer::on_actionSpectrum_triggered()
     this->updateColorScheme();
 }
 
+void WaterfallViewer::selectScale(SpectrumScale scale)
+{
+    this->ui->actionScaleMagnitude->setChecked(scale == SpectrumScale_Magnitude);
+    this->ui->actionScalePower->setChecked(scale == SpectrumScale_Power);
+    this->ui->actionScaleDecibel->setChecked(scale == SpectrumScale_Decibel);
+}
+
+SpectrumScale WaterfallViewer::selectedScale()
+{
+    if (this->ui->actionScaleDecibel->isChecked())
+        return SpectrumScale_Decibel;
+    if (this->ui->actionScalePower->isChecked())
+        return SpectrumScale_Power;
+    return SpectrumScale_Magnitude;
+}
+
+void WaterfallViewer::on_actionScaleMagnitude_triggered()
+{
+    this->selectScale(SpectrumScale_Magnitude);
+}
+
+void WaterfallViewer::on_actionScalePower_triggered()
+{
+    this->selectScale(SpectrumScale_Power);
+}
+
+void WaterfallViewer::on_actionScaleDecibel_triggered()
+{
+    this->selectScale(SpectrumScale_Decibel);
+}
+
+void WaterfallViewer::selectWindow(WindowFunction function)
+{
+    this->ui->actionWindowRectangular->setChecked(function == WindowFunction_Rectangular);
+    this->ui->actionWindowHann->setChecked(function == WindowFunction_Hann);
+    this->ui->actionWindowBlackmanHarris->setChecked(function == WindowFunction_BlackmanHarris);
+    this->ui->actionWindowKaiser->setChecked(function == WindowFunction_Kaiser);
+    this->ui->actionWindowFlatTop->setChecked(function == WindowFunction_FlatTop);
+}
+
+WindowFunction WaterfallViewer::selectedWindow()
+{
+    if (this->ui->actionWindowHann->isChecked())
+        return WindowFunction_Hann;
+    if (this->ui->actionWindowBlackmanHarris->isChecked())
+        return WindowFunction_BlackmanHarris;
+    if (this->ui->actionWindowKaiser->isChecked())
+        return WindowFunction_Kaiser;
+    if (this->ui->actionWindowFlatTop->isChecked())
+        return WindowFunction_FlatTop;
+    return WindowFunction_Rectangular;
+}
+
+void WaterfallViewer::on_actionWindowRectangular_triggered()
+{
+    this->selectWindow(WindowFunction_Rectangular);
+}
+
+void WaterfallViewer::on_actionWindowHann_triggered()
+{
+    this->selectWindow(WindowFunction_Hann);
+}
+
+void WaterfallViewer::on_actionWindowBlackmanHarris_triggered()
+{
+    this->selectWindow(WindowFunction_BlackmanHarris);
+}
+
+void WaterfallViewer::on_actionWindowKaiser_triggered()
+{
+    this->selectWindow(WindowFunction_Kaiser);
+}
+
+void WaterfallViewer::on_actionWindowFlatTop_triggered()
+{
+    this->selectWindow(WindowFunction_FlatTop);
+}
+
+void WaterfallViewer::selectReduce(SpectrumReduce reduce)
+{
+    this->ui->actionReduceMean->setChecked(reduce == SpectrumReduce_Mean);
+    this->ui->actionReduceMaxHold->setChecked(reduce == SpectrumReduce_MaxHold);
+    this->ui->actionReduceMinHold->setChecked(reduce == SpectrumReduce_MinHold);
+}
+
+SpectrumReduce WaterfallViewer::selectedReduce()
+{
+    if (this->ui->actionReduceMaxHold->isChecked())
+        return SpectrumReduce_MaxHold;
+    if (this->ui->actionReduceMinHold->isChecked())
+        return SpectrumReduce_MinHold;
+    return SpectrumReduce_Mean;
+}
+
+void WaterfallViewer::on_actionReduceMean_triggered()
+{
+    this->selectReduce(SpectrumReduce_Mean);
+}
+
+void WaterfallViewer::on_actionReduceMaxHold_triggered()
+{
+    this->selectReduce(SpectrumReduce_MaxHold);
+}
+
+void WaterfallViewer::on_actionReduceMinHold_triggered()
+{
+    this->selectReduce(SpectrumReduce_MinHold);
+}
+
 void WaterfallViewer::on_openFileButton_clicked()
 {
     this->ui->actionOpen_file->trigger();
@@ -6,6 +6,8 @@
 #include <QFileInfo>
 #include <QString>
 #include <QSettings>
+#include <QStandardPaths>
+#include <QDir>
 #include <QLineEdit>
 #include <QLabel>
 #include <QMetaType>
@@ -16,6 +18,7 @@
 #include <QFile>
 #include <QKeyEvent>
 #include <QMessageBox>
+#include <QFileSystemWatcher>
 
 #include "dsp.hpp"
 #include "qcustomplot.h"
@@ -23,6 +26,12 @@
 #include "customtoolbar.h"
 #include "colormapworker.h"
 #include "utilitytoolbar.h"
+#include "samplesource.h"
+#include "chunkstreamer.h"
+#include "sigmf.h"
+#include "iqcontainer.hpp"
+#include "ddc.hpp"
+#include "fftbackend.hpp"
 
 #include <fstream>
 #include <algorithm>
@@ -57,7 +66,17 @@ class WaterfallViewer : public QMainWindow
 {
     Q_OBJECT
 
-    static constexpr uint64_t maxFileSize = 128 * 1024 * 1024;
+    static constexpr uint64_t maxColorMapSize = 2048ULL * 1024 * 1024;
+    static constexpr uint64_t streamingBudget = 256ULL * 1024 * 1024;
+    static constexpr uint64_t dcEstimateSamples = 1024 * 1024;
+    // Color range of the dB scale below the map maximum
+    static constexpr float decibelSpan = 90.0f;
+    // FFT field values up to this one are orders, larger ones are sizes
+    static constexpr uint32_t maxFFTOrder = 30;
+    // Largest FFT size in points, larger orders and sizes are rejected
+    static constexpr uint32_t maxFFTSize = 1 << 24;
+    // Filter bank rows read this many windows at most
+    static constexpr uint32_t maxPFBTaps = 64;
 
     size_t availThreads{0};
 
@@ -72,13 +91,50 @@ class WaterfallViewer : public QMainWindow
     std::pair<double, double> fPoint;
     std::pair<double, double> sPoint;
 
-    std::vector<std::complex<float>> complexSignal;
+    SampleSource source;
 
     double Fs = 1100e6;
     double ts = 0.0;
-    double fftOrder = 0.0;
+    uint32_t fftSize = 1024;
     double fftResolution = 0.0;
     double scale = 0.0;
+    size_t average = 1;
+    size_t pfbTaps = 1;
+    int sampleFormatIndex = 0;
+    double timeOffset = 0.0;
+    double timeLength = 0.0;
+
+    uint64_t rangeFirst = 0;
+    size_t rangeStep = 1;
+    // Samples covered by one row: the window (times the filter bank taps),
+    // or all transforms of an averaged row
+    size_t rangeSpan = 1;
+
+    SigMFMeta sigmf;
+    bool sigmfRecord = false;
+
+    // Live tail state of the last started pass
+    QFileSystemWatcher * recordWatcher;
+    QString tailFile;
+    SampleFormat tailFormat = SampleFormat_CS16;
+    uint16_t tailIoMode = ChunkStreamer::ChunkStreamer_Mode_Mapped;
+    bool tailMapAll = true;
+    bool tailFollowable = false;
+    size_t tailWindowSize = 0;
+    size_t tailRows = 0;
+    ColorMapWorkerParams tailParams;
+
+    bool processingActive = false;
+    bool tailPass = false;
+    bool tailPending = false;
+
+    std::thread compressThread;
+    std::atomic_bool compressRunning{false};
+    std::atomic_bool compressStop{false};
+
+    std::thread ddcThread;
+    std::atomic_bool ddcRunning{false};
+    std::atomic_bool ddcStop{false};
 
     QVector<double> dotGraphKeys;
     QVector<double> dotGraphVals;
@@ -87,7 +143,8 @@ class WaterfallViewer : public QMainWindow
 
     QVector<ColorMapWorker*> workers;
     std::vector<FileListItem> filesVector;
-    std::vector<ColorMapWorkerTask *> tasks;
+    TaskQueue<std::shared_ptr<ColorMapWorkerTask>> tasks;
+    ChunkStreamer streamer{&source, &tasks};
 
     QCPColorMap * colorMap{nullptr};
 
@@ -109,6 +166,17 @@ private slots:
     void sampleRateChanged(const QString & text);
     void fftOrderChanged(const QString & text);
     void scaleFactorChanged(const QString & text);
+    void averageCountChanged(const QString & text);
+    void pfbTapsChanged(const QString & text);
+    void sampleFormatChanged(int index);
+    void timeOffsetChanged(const QString & text);
+    void timeLengthChanged(const QString & text);
+
+    void on_actionProcessSelection_triggered();
+    void on_actionCompressRecord_triggered();
+    void on_actionZoomBand_triggered();
+    void on_actionFollow_triggered(bool checked);
+    void recordFileChanged(const QString & path);
 
     void onProcessingComplete(void);
 
@@ -124,6 +192,20 @@ private slots:
     void on_actionGrayscale_triggered();
     void on_actionSpectrum_triggered();
 
+    void on_actionScaleMagnitude_triggered();
+    void on_actionScalePower_triggered();
+    void on_actionScaleDecibel_triggered();
+
+    void on_actionWindowRectangular_triggered();
+    void on_actionWindowHann_triggered();
+    void on_actionWindowBlackmanHarris_triggered();
+    void on_actionWindowKaiser_triggered();
+    void on_actionWindowFlatTop_triggered();
+
+    void on_actionReduceMean_triggered();
+    void on_actionReduceMaxHold_triggered();
+    void on_actionReduceMinHold_triggered();
+
     void on_openFileButton_clicked();
 
 private:
@@ -132,6 +214,21 @@ private:
     void cleanPlotter(void);
     void colorMapCreation(void);
     void startProcessing(void);
+    ColorMapWorkerParams workerParams(size_t windowSize);
+    void selectScale(SpectrumScale scale);
+    SpectrumScale selectedScale(void);
+    void selectWindow(WindowFunction function);
+    WindowFunction selectedWindow(void);
+    void selectReduce(SpectrumReduce reduce);
+    SpectrumReduce selectedReduce(void);
+    SampleFormat recordFormat(void);
+    void applySigMFMeta(void);
+    void drawSigMFOverlay(size_t windowSize, size_t step, size_t maps);
+    void stopProcessing(void);
+    void startTailProcessing(void);
+    void updateRecordWatch(void);
+    void onCompressionComplete(const QString & output, uint64_t inputBytes, uint64_t outputBytes);
+    void onZoomBandComplete(const QString & output, uint64_t samples, double sampleRate, double frequency);
     void updateColorScheme(void);
 
     void keyPressEvent(QKeyEvent *ev);
@@ -0,0 +1,224 @@
+#ifndef WINDOW_HPP
+#define WINDOW_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "dsp.hpp"
+
+// =============================================================================
+// Window functions of the FFT input
+// =============================================================================
+//
+// Tables are periodic (DFT-even) windows, built once per function, size and
+// record kind and shared read-only by the workers. Every conversion kernel
+// multiplies by the table in the pass that widens the samples, so windowing
+// costs one multiply per component and no sweep of its own.
+//
+// The float table is divided by the coherent gain (mean of the window): a
+// tone keeps its amplitude in the displayed spectrum for every function.
+// The Q15 table of the fixed-point path can not exceed one, so it holds the
+// plain window in the bit-reversed order of the gathered row, and the
+// correction goes into the block exponent scale.
+//
+// Real records are windowed over all 2 n real samples: the pair l of a
+// packed row takes {w[2 l], w[2 l + 1]}. Complex rows use {w[l], w[l]}.
+//
+// With taps > 1 the table is the prototype filter of a polyphase filter
+// bank (pfb.hpp): the window stretched over taps transforms times a sinc one
+// bin wide, the same layout over taps * n pairs. Its coherent gain is the
+// sum over n (2 n for real records), so a tone on a bin keeps its amplitude
+// as well. Fixed-point tables are built for single transforms only.
+
+enum WindowFunction {
+    WindowFunction_Rectangular = 0,
+    WindowFunction_Hann,
+    WindowFunction_BlackmanHarris,
+    WindowFunction_Kaiser,
+    WindowFunction_FlatTop
+};
+
+inline const char * windowFunctionName(WindowFunction function)
+{
+    switch (function) {
+    case WindowFunction_Hann: return "Hann";
+    case WindowFunction_BlackmanHarris: return "Blackman-Harris";
+    case WindowFunction_Kaiser: return "Kaiser";
+    case WindowFunction_FlatTop: return "flat top";
+    default: return "rectangular";
+    }
+}
+
+/**
+ * @brief Модифицированная функция Бесселя первого рода нулевого порядка
+ */
+inline double windowBesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Отсчёт k периодического окна длины length
+ * @param beta Параметр окна Кайзера
+ */
+inline double windowValue(WindowFunction function, size_t k, size_t length, double beta)
+{
+    const double phase = 2.0 * M_PI * (double)k / (double)length;
+    switch (function) {
+    case WindowFunction_Hann:
+        return 0.5 - 0.5 * std::cos(phase);
+    case WindowFunction_BlackmanHarris:
+        return 0.35875 - 0.48829 * std::cos(phase) + 0.14128 * std::cos(2 * phase) - \
+               0.01168 * std::cos(3 * phase);
+    case WindowFunction_Kaiser: {
+        const double r = 2.0 * (double)k / (double)length - 1.0;
+        return windowBesselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / windowBesselI0(beta);
+    }
+    case WindowFunction_FlatTop:
+        return 0.21557895 - 0.41663158 * std::cos(phase) + 0.277263158 * std::cos(2 * phase) - \
+               0.083578947 * std::cos(3 * phase) + 0.006947368 * std::cos(4 * phase);
+    default:
+        return 1.0;
+    }
+}
+
+/**
+ * @brief Таблицы окна для строки из n комплексных отсчётов
+ *
+ * Для прямоугольного окна таблиц нет: values() и fixedValues() возвращают
+ * nullptr, и ядра загрузки работают как без окна.
+ */
+class FFTWindow {
+protected:
+    WindowFunction windowFunction;
+    size_t length;
+    size_t tapsCount;
+    double coherent{1.0};
+    double noiseBandwidth{1.0};
+    std::vector<float> table;
+    std::vector<int16_t> fixedTable;
+
+public:
+    FFTWindow(WindowFunction function, size_t n, bool real, double beta, size_t taps = 1) : \
+        windowFunction(function), length(n), tapsCount(std::max<size_t>(1, taps)) {
+
+        if ((function == WindowFunction_Rectangular && this->tapsCount == 1) || n == 0) {
+            return;
+        }
+        const size_t span = real ? 2 * n : n;
+        const size_t total = span * this->tapsCount;
+        std::vector<double> w(total);
+        double sum = 0, squares = 0;
+        for (size_t k = 0; k < total; k++) {
+            w[k] = windowValue(function, k, total, beta);
+            if (this->tapsCount > 1) {
+                // Channel response one bin wide, centred on the stretched window
+                const double t = M_PI * ((double)k - (double)total / 2.0) / (double)span;
+                w[k] *= t == 0 ? 1.0 : std::sin(t) / t;
+            }
+            sum += w[k];
+            squares += w[k] * w[k];
+        }
+        this->coherent = sum / (double)span;
+        this->noiseBandwidth = (double)span * squares / (sum * sum);
+
+        // Lane c of the interleaved rows takes w[c] (real) or w[c / 2] (complex)
+        const size_t count = 2 * n * this->tapsCount;
+        this->table.resize(count);
+        for (size_t c = 0; c < count; c++) {
+            this->table[c] = (float)(w[real ? c : c / 2] / this->coherent);
+        }
+
+        if (this->tapsCount == 1 && n > 1 && (n & (n - 1)) == 0) {
+            const int log2n = (int)std::log2(n);
+            this->fixedTable.resize(count);
+            for (size_t i = 0; i < n; i++) {
+                const size_t l = bitReverse(i, log2n);
+                for (size_t c = 0; c < 2; c++) {
+                    const double v = w[real ? 2 * l + c : l];
+                    this->fixedTable[2 * i + c] = (int16_t)std::lround(v * 32767.0);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Общая таблица, строится при первом запросе
+     * @param beta Параметр окна Кайзера, для остальных окон не учитывается
+     * @param taps Отводов на канал банка фильтров, 1 - обычное окно
+     */
+    static const FFTWindow & get(WindowFunction function, size_t n, bool real, double beta, size_t taps = 1) {
+        static std::mutex windowsMutex;
+        static std::map<std::tuple<int, size_t, bool, double, size_t>, std::unique_ptr<FFTWindow>> windows;
+        if (function != WindowFunction_Kaiser) {
+            beta = 0;
+        }
+        std::lock_guard<std::mutex> lock(windowsMutex);
+        std::unique_ptr<FFTWindow> & window = windows[std::make_tuple((int)function, n, real, beta, taps)];
+        if (!window) {
+            window.reset(new FFTWindow(function, n, real, beta, taps));
+        }
+        return *window;
+    }
+
+    WindowFunction function(void) const {
+        return this->windowFunction;
+    }
+
+    size_t size(void) const {
+        return this->length;
+    }
+
+    /**
+     * @brief Отводов на канал: длина таблицы в преобразованиях
+     */
+    size_t taps(void) const {
+        return this->tapsCount;
+    }
+
+    /**
+     * @brief Множители 2 n taps компонент {re, im}, делённые на когерентное усиление
+     */
+    const float * values(void) const {
+        return this->table.empty() ? nullptr : this->table.data();
+    }
+
+    /**
+     * @brief Q15-множители в бит-реверсивном порядке точек (только 2^n)
+     */
+    const int16_t * fixedValues(void) const {
+        return this->fixedTable.empty() ? nullptr : this->fixedTable.data();
+    }
+
+    /**
+     * @brief Когерентное усиление: среднее значение окна
+     */
+    double coherentGain(void) const {
+        return this->coherent;
+    }
+
+    /**
+     * @brief Эквивалентная шумовая полоса в бинах
+     */
+    double enbw(void) const {
+        return this->noiseBandwidth;
+    }
+};
+
+// =============================================================================
+
+#endif // WINDOW_HPP